@@ -16,3 +16,23 @@ int init_queue()
 
     return msqid;
 }
+
+int queue_send(int msqid, const struct mbuf *msg, size_t len, int flags)
+{
+    return msgsnd(msqid, msg, len, flags);
+}
+
+ssize_t queue_receive(int msqid, struct mbuf *msg, size_t maxBytes, long type, int flags)
+{
+    return msgrcv(msqid, msg, maxBytes, type, flags);
+}
+
+int queue_fd(int msqid) /* System V queues are not file descriptors */
+{
+    return -1;
+}
+
+int queue_has_types(void)
+{
+    return 1;
+}
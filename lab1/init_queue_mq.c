@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <mqueue.h>
+#include <time.h>
+#include <sys/msg.h>
+#include <sys/stat.h>
+#include "message_queue.h"
+
+/* Each POSIX message is a whole struct mbuf prefix: mtype then mtext bytes.
+   The descriptor stays in blocking mode; IPC_NOWAIT is done with the timed
+   calls and an already expired timeout, so one descriptor serves both. */
+
+static struct timespec *expiredTimeout(struct timespec *ts)
+{
+    ts->tv_sec = 0;
+    ts->tv_nsec = 0;
+    return ts;
+}
+
+int init_queue()
+{
+    struct mq_attr attr;
+    mqd_t mqd;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.mq_maxmsg = MQ_MAXMSG;
+    attr.mq_msgsize = sizeof(struct mbuf);
+    mqd = mq_open(MQ_NAME, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR, &attr);
+
+    if (mqd == (mqd_t) -1) {
+        fprintf(stderr, "Error creating message queue.");
+        exit(EXIT_FAILURE);
+    }
+
+    return (int) mqd;
+}
+
+int queue_send(int msqid, const struct mbuf *msg, size_t len, int flags)
+{
+    struct timespec ts;
+
+    if (msg->mtype < 1 || len > MAX_MTEXT) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    len += offsetof(struct mbuf, mtext);
+
+    if (((flags & IPC_NOWAIT) ? mq_timedsend((mqd_t) msqid, (const char *) msg, len, 0, expiredTimeout(&ts))
+                              : mq_send((mqd_t) msqid, (const char *) msg, len, 0)) == -1) {
+        if (errno == ETIMEDOUT) {
+            errno = EAGAIN; /* What msgsnd() reports for a full queue */
+        }
+
+        return -1;
+    }
+
+    return 0;
+}
+
+ssize_t queue_receive(int msqid, struct mbuf *msg, size_t maxBytes, long type, int flags)
+{
+    struct mbuf buf;
+    struct timespec ts;
+    ssize_t n;
+
+    if (type != 0) { /* POSIX queues have no per-type selection */
+        errno = EINVAL;
+        return -1;
+    }
+
+    n = (flags & IPC_NOWAIT) ? mq_timedreceive((mqd_t) msqid, (char *) &buf, sizeof(buf), NULL, expiredTimeout(&ts))
+                             : mq_receive((mqd_t) msqid, (char *) &buf, sizeof(buf), NULL);
+
+    if (n == -1) {
+        if (errno == ETIMEDOUT) {
+            errno = ENOMSG; /* What msgrcv() reports for an empty queue */
+        }
+
+        return -1;
+    }
+
+    n -= offsetof(struct mbuf, mtext);
+
+    if ((size_t) n > maxBytes) {
+        if (!(flags & MSG_NOERROR)) { /* Unlike msgrcv(), the message is already gone */
+            errno = E2BIG;
+            return -1;
+        }
+
+        n = maxBytes;
+    }
+
+    msg->mtype = buf.mtype;
+    memcpy(msg->mtext, buf.mtext, n);
+
+    return n;
+}
+
+int queue_fd(int msqid) /* On Linux an mqd_t is a file descriptor */
+{
+    return msqid;
+}
+
+int queue_has_types(void) /* Only priorities, and mtype is not mapped to them */
+{
+    return 0;
+}
@@ -0,0 +1,202 @@
+/*
+ * Compile: gcc -o ipcq_top ipcq_top.c
+ * Run: ./ipcq_top [-d seconds] [-n iterations] [-s stall-seconds] [-b]
+ *
+ * top-like view of every System V message queue on the system. Each refresh
+ * walks the kernel's queue table with MSG_INFO/MSG_STAT (one msgctl() per
+ * slot, no messages touched) and compares with the previous sample:
+ *   NET/s    change in queued messages per second (+ filling, - draining)
+ *   FILL%    msg_cbytes / msg_qbytes
+ *   SND/RCV  seconds since the last msgsnd()/msgrcv()
+ *   ACT      S and/or R when a send/receive happened since the last sample
+ *   STALLED  messages waiting but no msgrcv() for stall-seconds
+ *   BUSY     both sides active (a balanced queue has NET/s near 0)
+ * The kernel keeps no per-queue send/receive counters, so real enqueue and
+ * dequeue rates cannot be had this way: NET/s is only their difference.
+ * ACT is derived from msg_stime/msg_rtime (whole seconds) and
+ * msg_lspid/msg_lrpid changing, or a time in the current second, so with
+ * -d below 1 s one steady sender or receiver can show up a sample late.
+ * -b prints plain appended reports instead of redrawing the screen.
+ */
+
+#define _GNU_SOURCE /* MSG_INFO, MSG_STAT, struct msginfo */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/msg.h>
+
+struct sample {
+    int msqid; /* -1 = slot unused */
+    unsigned long qnum;
+    unsigned long cbytes;
+    time_t stime, rtime;
+    pid_t lspid, lrpid;
+    double when;
+};
+
+struct row {
+    int msqid;
+    key_t key;
+    unsigned long qnum, cbytes, qbytes;
+    double netRate, byteRate, fill;
+    long sndAge, rcvAge;
+    pid_t lspid, lrpid;
+    int sndActive, rcvActive; /* Since the previous sample */
+    int stalled;
+};
+
+static double nowSec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int cmpRow(const void *a, const void *b) /* Stalled first, then fullest */
+{
+    const struct row *x = a, *y = b;
+
+    if (x->stalled != y->stalled) {
+        return y->stalled - x->stalled;
+    }
+
+    return (y->fill > x->fill) - (y->fill < x->fill);
+}
+
+int main(int argc, char *argv[])
+{
+    struct sample *prev = NULL;
+    struct row *rows = NULL;
+    struct msginfo info;
+    struct msqid_ds ds;
+    int capacity = 0, maxIdx, idx, nrows, msqid, opt, batch = 0;
+    long iterations = -1, stallSec = 5;
+    double interval = 1.0, t;
+    time_t wall;
+
+    while ((opt = getopt(argc, argv, "d:n:s:b")) != -1) {
+        switch (opt) {
+        case 'd': interval = atof(optarg); break;
+        case 'n': iterations = atol(optarg); break;
+        case 's': stallSec = atol(optarg); break;
+        case 'b': batch = 1; break;
+        default:
+            fprintf(stderr, "Usage: %s [-d seconds] [-n iterations] [-s stall-seconds] [-b]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    for (long it = 0; iterations < 0 || it < iterations; it++) {
+        maxIdx = msgctl(0, MSG_INFO, (struct msqid_ds *) &info);
+
+        if (maxIdx == -1) {
+            fprintf(stderr, "msgctl-MSG_INFO error");
+            exit(EXIT_FAILURE);
+        }
+
+        if (maxIdx + 1 > capacity) { /* Kernel table grew */
+            int old = capacity;
+
+            capacity = maxIdx + 1;
+            prev = realloc(prev, capacity * sizeof(*prev));
+            rows = realloc(rows, capacity * sizeof(*rows));
+
+            if (prev == NULL || rows == NULL) {
+                fprintf(stderr, "realloc error");
+                exit(EXIT_FAILURE);
+            }
+
+            for (idx = old; idx < capacity; idx++) {
+                prev[idx].msqid = -1;
+            }
+        }
+
+        t = nowSec();
+        wall = time(NULL);
+        nrows = 0;
+
+        for (idx = 0; idx <= maxIdx; idx++) {
+            struct row *r = &rows[nrows];
+            struct sample *p = &prev[idx];
+
+            msqid = msgctl(idx, MSG_STAT, &ds);
+
+            if (msqid == -1) { /* Empty slot or no read permission */
+                p->msqid = -1;
+                continue;
+            }
+
+            r->msqid = msqid;
+            r->key = ds.msg_perm.__key;
+            r->qnum = ds.msg_qnum;
+            r->cbytes = ds.msg_cbytes;
+            r->qbytes = ds.msg_qbytes;
+            r->fill = ds.msg_qbytes ? 100.0 * ds.msg_cbytes / ds.msg_qbytes : 0.0;
+            r->sndAge = ds.msg_stime ? (long) (wall - ds.msg_stime) : -1;
+            r->rcvAge = ds.msg_rtime ? (long) (wall - ds.msg_rtime) : -1;
+            r->lspid = ds.msg_lspid;
+            r->lrpid = ds.msg_lrpid;
+            r->netRate = r->byteRate = 0.0;
+
+            r->sndActive = r->sndAge == 0;
+            r->rcvActive = r->rcvAge == 0;
+
+            if (p->msqid == msqid && t > p->when) { /* Same queue as last sample */
+                r->netRate = ((double) r->qnum - p->qnum) / (t - p->when);
+                r->byteRate = ((double) r->cbytes - p->cbytes) / (t - p->when);
+                r->sndActive |= ds.msg_stime != p->stime || ds.msg_lspid != p->lspid;
+                r->rcvActive |= ds.msg_rtime != p->rtime || ds.msg_lrpid != p->lrpid;
+            }
+
+            /* Work is waiting but no consumer has taken anything lately */
+            r->stalled = r->qnum > 0 &&
+                         (r->rcvAge == -1 ? r->sndAge >= stallSec : r->rcvAge >= stallSec);
+
+            p->msqid = msqid;
+            p->qnum = r->qnum;
+            p->cbytes = r->cbytes;
+            p->stime = ds.msg_stime;
+            p->rtime = ds.msg_rtime;
+            p->lspid = ds.msg_lspid;
+            p->lrpid = ds.msg_lrpid;
+            p->when = t;
+            nrows++;
+        }
+
+        qsort(rows, nrows, sizeof(rows[0]), cmpRow);
+
+        if (!batch) {
+            printf("\033[H\033[2J");
+        }
+
+        printf("ipcq_top - %d queues, %d messages, %d bytes queued (system limits: "
+               "msgmnb=%d msgmni=%d)\n", info.msgpool, info.msgmap, info.msgtql,
+               info.msgmnb, info.msgmni);
+        printf("%10s %10s %8s %9s %11s %6s %8s %6s %6s %3s %7s %7s %s\n",
+               "MSQID", "KEY", "QNUM", "NET/s", "BYTES/s", "FILL%",
+               "QBYTES", "SND", "RCV", "ACT", "LSPID", "LRPID", "STATE");
+
+        for (idx = 0; idx < nrows; idx++) {
+            struct row *r = &rows[idx];
+
+            printf("%10d 0x%08x %8lu %+9.1f %+11.1f %6.1f %8lu %6ld %6ld %2s%c %7ld %7ld %s\n",
+                   r->msqid, (unsigned) r->key, r->qnum, r->netRate, r->byteRate,
+                   r->fill, r->qbytes, r->sndAge, r->rcvAge,
+                   r->sndActive ? "S" : "-", r->rcvActive ? 'R' : '-',
+                   (long) r->lspid, (long) r->lrpid,
+                   r->stalled ? "STALLED" : r->fill >= 90.0 ? "FULL"
+                   : (r->sndActive && r->rcvActive) ? "BUSY" : "");
+        }
+
+        fflush(stdout);
+
+        if (iterations < 0 || it + 1 < iterations) {
+            usleep((useconds_t) (interval * 1e6));
+        }
+    }
+
+    exit(EXIT_SUCCESS);
+}
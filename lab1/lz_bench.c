@@ -0,0 +1,147 @@
+/*
+ * Compile: gcc -O2 -o lz_bench lz_bench.c lz_codec.c
+ * Run: ./lz_bench [file]
+ *
+ * Compresses a file (default: generated log-like text) block by block at
+ * the block sizes the transports use and reports ratio and CPU cost
+ * against a plain memcpy of the same data. Every block is round-tripped.
+ * Each pass is timed as a whole; decompress-MB/s covers only the blocks
+ * that compressed (raw ones are sent as they are), in uncompressed bytes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lz_codec.h"
+
+#define CORPUS_SIZE (8 * 1024 * 1024)
+#define ROUNDS 5
+
+static double nowSec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static size_t makeCorpus(char *buf, size_t cap) /* Repetitive event text */
+{
+    static const char *levels[] = { "INFO", "INFO", "INFO", "WARN", "DEBUG" };
+    size_t len = 0;
+    unsigned seed = 1;
+    int n;
+
+    while (len + 128 < cap) {
+        n = snprintf(buf + len, cap - len,
+                     "2026-10-17T12:%02d:%02d.%03d %s worker-%d processed request id=%u "
+                     "status=%s latency=%uus\n",
+                     rand_r(&seed) % 60, rand_r(&seed) % 60, rand_r(&seed) % 1000,
+                     levels[rand_r(&seed) % 5], rand_r(&seed) % 8, rand_r(&seed) % 100000,
+                     rand_r(&seed) % 20 ? "OK" : "RETRY", rand_r(&seed) % 5000);
+        len += n;
+    }
+
+    return len;
+}
+
+int main(int argc, char *argv[])
+{
+    static const size_t blocks[] = { 256, 1024, 4096, 16384 };
+    char *data, *comp, *back;
+    size_t *clen, len, block, off, n, k, in, out, packed, rawBlocks;
+    double t0, tc, td, tm;
+    FILE *fp;
+
+    data = malloc(CORPUS_SIZE);
+    comp = malloc(CORPUS_SIZE);
+    back = malloc(CORPUS_SIZE);
+    clen = malloc((CORPUS_SIZE / blocks[0] + 1) * sizeof(*clen));
+
+    if (data == NULL || comp == NULL || back == NULL || clen == NULL) {
+        fprintf(stderr, "malloc error");
+        exit(EXIT_FAILURE);
+    }
+
+    if (argc > 1) {
+        if ((fp = fopen(argv[1], "rb")) == NULL) {
+            perror(argv[1]);
+            exit(EXIT_FAILURE);
+        }
+
+        len = fread(data, 1, CORPUS_SIZE, fp);
+        fclose(fp);
+    } else {
+        len = makeCorpus(data, CORPUS_SIZE);
+    }
+
+    printf("input %zu bytes\n", len);
+    printf("block   ratio  raw-blocks  compress-MB/s  decompress-MB/s  memcpy-MB/s\n");
+
+    for (size_t b = 0; b < sizeof(blocks) / sizeof(blocks[0]); b++) {
+        block = blocks[b];
+        tc = td = tm = 0;
+
+        for (int r = 0; r < ROUNDS; r++) {
+            /* Compressed block k goes to comp + off, never longer than n */
+            t0 = nowSec();
+
+            for (off = 0, k = 0; off < len; off += n, k++) {
+                n = (len - off < block) ? len - off : block;
+                clen[k] = lzCompress(data + off, n, comp + off, n);
+            }
+
+            tc += nowSec() - t0;
+            t0 = nowSec();
+
+            for (off = 0, k = 0; off < len; off += n, k++) {
+                n = (len - off < block) ? len - off : block;
+
+                if (clen[k] != 0 && lzDecompress(comp + off, clen[k], back + off, n) != (ssize_t) n) {
+                    fprintf(stderr, "decompress failed at offset %zu\n", off);
+                    exit(EXIT_FAILURE);
+                }
+            }
+
+            td += nowSec() - t0;
+            t0 = nowSec();
+
+            for (off = 0; off < len; off += n) {
+                n = (len - off < block) ? len - off : block;
+                memcpy(back + off, data + off, n);
+            }
+
+            tm += nowSec() - t0;
+        }
+
+        /* Tally and check the last round outside the timed loops */
+        in = out = packed = rawBlocks = 0;
+
+        for (off = 0, k = 0; off < len; off += n, k++) {
+            n = (len - off < block) ? len - off : block;
+            in += n;
+
+            if (clen[k] == 0) { /* Incompressible: would be sent raw */
+                rawBlocks++;
+                out += n;
+                continue;
+            }
+
+            out += clen[k];
+            packed += n;
+
+            if (lzDecompress(comp + off, clen[k], back, n) != (ssize_t) n ||
+                    memcmp(back, data + off, n) != 0) {
+                fprintf(stderr, "round trip failed at offset %zu\n", off);
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        printf("%5zu %7.2f %11zu %14.1f %16.1f %12.1f\n", block, (double) in / out, rawBlocks,
+               ROUNDS * in / tc / 1e6, td > 0 ? ROUNDS * packed / td / 1e6 : 0.0,
+               ROUNDS * in / tm / 1e6);
+    }
+
+    exit(EXIT_SUCCESS);
+}
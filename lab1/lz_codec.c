@@ -0,0 +1,213 @@
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include "lz_codec.h"
+
+#define HASH_BITS 12
+#define MAX_OFFSET 65535
+#define LAST_LITERALS 5 /* Block always ends with a few literals */
+
+static uint32_t read32(const unsigned char *p)
+{
+    uint32_t v;
+
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static unsigned hashSeq(uint32_t seq)
+{
+    return (seq * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/* Writes the extra bytes of a length >= 15; NULL if dst runs out */
+static unsigned char *putLength(unsigned char *op, unsigned char *end, size_t len)
+{
+    for (len -= 15; ; len -= 255) {
+        if (op >= end) {
+            return NULL;
+        }
+
+        if (len < 255) {
+            *op++ = len;
+            return op;
+        }
+
+        *op++ = 255;
+    }
+}
+
+static unsigned char *putSequence(unsigned char *op, unsigned char *end,
+                                  const unsigned char *lit, size_t litLen,
+                                  size_t offset, size_t matchLen)
+{
+    unsigned char *token = op++;
+
+    if (token >= end) {
+        return NULL;
+    }
+
+    *token = (litLen >= 15 ? 15 : litLen) << 4;
+
+    if (litLen >= 15 && (op = putLength(op, end, litLen)) == NULL) {
+        return NULL;
+    }
+
+    if ((size_t) (end - op) < litLen) {
+        return NULL;
+    }
+
+    memcpy(op, lit, litLen);
+    op += litLen;
+
+    if (matchLen == 0) { /* Final literals-only sequence */
+        return op;
+    }
+
+    if (end - op < 2) {
+        return NULL;
+    }
+
+    *op++ = offset & 0xff;
+    *op++ = offset >> 8;
+    matchLen -= LZ_MIN_MATCH;
+    *token |= (matchLen >= 15) ? 15 : matchLen;
+
+    if (matchLen >= 15) {
+        op = putLength(op, end, matchLen);
+    }
+
+    return op;
+}
+
+/* Returns the compressed size, or 0 if it would not be smaller than the
+   input or does not fit in dstCap: callers then send the data raw. */
+size_t lzCompress(const void *src, size_t srcLen, void *dst, size_t dstCap)
+{
+    const unsigned char *in = src, *anchor = in, *ip = in, *ref;
+    const unsigned char *limit = in + (srcLen > LAST_LITERALS ? srcLen - LAST_LITERALS : 0);
+    unsigned char *op = dst, *end = op + (dstCap < srcLen ? dstCap : srcLen);
+    int32_t table[1 << HASH_BITS];
+    size_t len;
+    uint32_t seq;
+    unsigned h;
+
+    memset(table, 0xff, sizeof(table)); /* -1: no earlier position */
+
+    while (ip + LZ_MIN_MATCH <= limit) {
+        seq = read32(ip);
+        h = hashSeq(seq);
+        ref = (table[h] >= 0) ? in + table[h] : NULL;
+        table[h] = ip - in;
+
+        if (ref == NULL || ip - ref > MAX_OFFSET || read32(ref) != seq) {
+            ip++;
+            continue;
+        }
+
+        for (len = LZ_MIN_MATCH; ip + len < limit && ref[len] == ip[len]; len++) {
+            continue;
+        }
+
+        op = putSequence(op, end, anchor, ip - anchor, ip - ref, len);
+
+        if (op == NULL) {
+            return 0;
+        }
+
+        ip += len;
+        anchor = ip;
+    }
+
+    op = putSequence(op, end, anchor, in + srcLen - anchor, 0, 0);
+
+    if (op == NULL || (size_t) (op - (unsigned char *) dst) >= srcLen) {
+        return 0;
+    }
+
+    return op - (unsigned char *) dst;
+}
+
+static const unsigned char *getLength(const unsigned char *ip, const unsigned char *end,
+                                      size_t *len)
+{
+    unsigned b;
+
+    do {
+        if (ip >= end) {
+            return NULL;
+        }
+
+        b = *ip++;
+        *len += b;
+    } while (b == 255);
+
+    return ip;
+}
+
+/* Returns the decompressed size, or -1 with errno EBADMSG for a corrupt
+   block or one that does not fit in dstCap */
+ssize_t lzDecompress(const void *src, size_t srcLen, void *dst, size_t dstCap)
+{
+    const unsigned char *ip = src, *end = ip + srcLen;
+    unsigned char *op = dst, *opEnd = op + dstCap, *match;
+    size_t litLen, matchLen, offset;
+    unsigned token;
+
+    while (ip < end) {
+        token = *ip++;
+        litLen = token >> 4;
+
+        if (litLen == 15 && (ip = getLength(ip, end, &litLen)) == NULL) {
+            goto corrupt;
+        }
+
+        if ((size_t) (end - ip) < litLen || (size_t) (opEnd - op) < litLen) {
+            goto corrupt;
+        }
+
+        memcpy(op, ip, litLen);
+        op += litLen;
+        ip += litLen;
+
+        if (ip == end) { /* Final sequence has no match */
+            break;
+        }
+
+        if (end - ip < 2) {
+            goto corrupt;
+        }
+
+        offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        matchLen = token & 15;
+
+        if (matchLen == 15 && (ip = getLength(ip, end, &matchLen)) == NULL) {
+            goto corrupt;
+        }
+
+        matchLen += LZ_MIN_MATCH;
+
+        if (offset == 0 || offset > (size_t) (op - (unsigned char *) dst) ||
+                (size_t) (opEnd - op) < matchLen) {
+            goto corrupt;
+        }
+
+        match = op - offset;
+
+        if (offset >= matchLen) {
+            memcpy(op, match, matchLen);
+            op += matchLen;
+        } else {
+            while (matchLen-- > 0) { /* Overlapping run: copy byte by byte */
+                *op++ = *match++;
+            }
+        }
+    }
+
+    return op - (unsigned char *) dst;
+
+corrupt:
+    errno = EBADMSG;
+    return -1;
+}
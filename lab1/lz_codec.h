@@ -0,0 +1,20 @@
+#ifndef LZ_CODEC_H
+#define LZ_CODEC_H /* Prevent accidental double inclusion */
+
+#include <stddef.h>
+#include <sys/types.h>
+
+/* Small LZ77 block codec in the LZ4 style, for repetitive text payloads.
+   A block is a series of sequences:
+       token: high nibble literal count, low nibble match length - 4
+              (15 = more length bytes follow, each adding up to 255)
+       literals, then a 2-byte little-endian match offset
+   The last sequence holds only literals. No framing, no checksum: callers
+   record that a payload is compressed with a flag bit in their own header. */
+
+#define LZ_MIN_MATCH 4
+
+size_t lzCompress(const void *src, size_t srcLen, void *dst, size_t dstCap);
+ssize_t lzDecompress(const void *src, size_t srcLen, void *dst, size_t dstCap);
+
+#endif
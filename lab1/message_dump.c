@@ -0,0 +1,281 @@
+/*
+ * Compile: gcc -o message_dump message_dump.c
+ * Run: ./message_dump [-o file] [-n max-messages] msqid
+ *
+ * Inspects a queue without consuming it: messages are copied out by index
+ * with MSG_COPY, so consumers are not disturbed. Prints a histogram by type,
+ * size and age (age is known for messages carrying the msg_ttl.h header),
+ * and with -o streams every message to a compact binary file:
+ *     "MQD1" then per message: int64 mtype, int64 age-ns (-1 unknown),
+ *     uint32 length, length bytes
+ * Memory use is fixed whatever the queue length. Each MSG_COPY makes the
+ * kernel walk the list up to the index under the queue lock, so a walk of
+ * n messages costs O(n^2) and holds up senders and receivers for longer
+ * the deeper it goes: by default it stops after DUMP_DEFAULT_MAX messages,
+ * -n 0 walks everything. Consumers running meanwhile shift the indices, so
+ * the result is a best-effort snapshot.
+ * Needs a kernel built with CONFIG_CHECKPOINT_RESTORE.
+ */
+
+#define _GNU_SOURCE /* MSG_COPY */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/msg.h>
+#include "msg_ttl.h" /* Only for the header layout */
+
+#define TYPE_SLOTS 4096 /* Distinct types tracked; the rest go to "other" */
+#define SIZE_BUCKETS 12 /* 0, 1, 2-3, 4-7, ... 1024 and up */
+#define AGE_BUCKETS 8 /* <1ms, <10ms, ... <1000s, older */
+#define DUMP_DEFAULT_MAX 10000 /* Messages walked without -n */
+
+struct dump_msg { /* Sized at run time, MSG_COPY cannot truncate */
+    long mtype;
+    char mtext[];
+};
+
+struct type_count {
+    long mtype;
+    long count;
+    long bytes;
+};
+
+static struct type_count types[TYPE_SLOTS];
+static long otherTypes;
+
+static long long nowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void countType(long mtype, size_t len)
+{
+    unsigned long h = (unsigned long) mtype * 2654435761UL;
+
+    for (int probe = 0; probe < TYPE_SLOTS; probe++) {
+        struct type_count *t = &types[(h + probe) % TYPE_SLOTS];
+
+        if (t->count == 0 || t->mtype == mtype) {
+            t->mtype = mtype;
+            t->count++;
+            t->bytes += len;
+            return;
+        }
+    }
+
+    otherTypes++;
+}
+
+static int sizeBucket(size_t len)
+{
+    int b = 0;
+
+    while (len > 0 && b < SIZE_BUCKETS - 1) {
+        len >>= 1;
+        b++;
+    }
+
+    return b;
+}
+
+static int cmpType(const void *a, const void *b)
+{
+    const struct type_count *x = a, *y = b;
+
+    return (y->count > x->count) - (y->count < x->count);
+}
+
+static void bar(long n, long total)
+{
+    int width = total ? (int) (40 * n / total) : 0;
+
+    for (int j = 0; j < width; j++) {
+        putchar('#');
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    static const char *ageNames[AGE_BUCKETS] = {
+        "<1ms", "<10ms", "<100ms", "<1s", "<10s", "<100s", "<1000s", ">=1000s"
+    };
+    long sizes[SIZE_BUCKETS] = { 0 }, ages[AGE_BUCKETS] = { 0 };
+    long maxMessages = DUMP_DEFAULT_MAX, total = 0, unknownAge = 0, bytes = 0, idx;
+    const char *outPath = NULL;
+    long long now = nowNs();
+    struct ttl_hdr h;
+    struct msginfo info;
+    struct msqid_ds ds;
+    struct dump_msg *msg;
+    size_t msgSize;
+    FILE *out = NULL;
+    int64_t mtype, age;
+    uint32_t len32;
+    ssize_t n;
+    int msqid, opt, j;
+
+    while ((opt = getopt(argc, argv, "o:n:")) != -1) {
+        switch (opt) {
+        case 'o': outPath = optarg; break;
+        case 'n': maxMessages = atol(optarg); break;
+        default: optind = argc + 1; break;
+        }
+    }
+
+    if (optind != argc - 1) {
+        fprintf(stderr, "Usage: %s [-o file] [-n max-messages] msqid\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    msqid = atoi(argv[optind]);
+
+    /* Room for the largest message the system allows; a queue may still
+       hold a bigger one sent before msgmax was lowered, see E2BIG below */
+    if (msgctl(0, MSG_INFO, (struct msqid_ds *) &info) == -1 ||
+            msgctl(msqid, IPC_STAT, &ds) == -1) {
+        perror("msgctl");
+        exit(EXIT_FAILURE);
+    }
+
+    msgSize = info.msgmax;
+
+    if ((msg = malloc(sizeof(*msg) + msgSize)) == NULL) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
+
+    if (outPath != NULL) {
+        out = fopen(outPath, "wb");
+
+        if (out == NULL || fwrite("MQD1", 1, 4, out) != 4) {
+            perror(outPath);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    for (idx = 0; maxMessages <= 0 || idx < maxMessages; idx++) {
+        n = msgrcv(msqid, msg, msgSize, idx, MSG_COPY | IPC_NOWAIT);
+
+        if (n == -1) {
+            if (errno == ENOMSG) { /* Past the last message */
+                break;
+            }
+
+            if (errno == E2BIG && msgSize < ds.msg_qbytes) { /* Grow, try again */
+                struct dump_msg *bigger = realloc(msg, sizeof(*msg) + 2 * msgSize);
+
+                if (bigger != NULL) {
+                    msg = bigger;
+                    msgSize *= 2;
+                    idx--;
+                    continue;
+                }
+            }
+
+            perror("msgrcv MSG_COPY");
+            exit(EXIT_FAILURE);
+        }
+
+        age = -1;
+
+        if (n >= (ssize_t) sizeof(h)) {
+            memcpy(&h, msg->mtext, sizeof(h));
+
+            if (h.magic == TTL_MAGIC) {
+                age = now - h.enqNs;
+            }
+        }
+
+        total++;
+        bytes += n;
+        countType(msg->mtype, n);
+        sizes[sizeBucket(n)]++;
+
+        if (age < 0) {
+            unknownAge++;
+        } else {
+            long long a = age / 1000000LL; /* Whole milliseconds */
+
+            for (j = 0; j < AGE_BUCKETS - 1 && a >= 1; j++) {
+                a /= 10;
+            }
+
+            ages[j]++;
+        }
+
+        if (out != NULL) {
+            mtype = msg->mtype;
+            len32 = n;
+
+            if (fwrite(&mtype, sizeof(mtype), 1, out) != 1 ||
+                    fwrite(&age, sizeof(age), 1, out) != 1 ||
+                    fwrite(&len32, sizeof(len32), 1, out) != 1 ||
+                    fwrite(msg->mtext, 1, n, out) != (size_t) n) {
+                perror(outPath);
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+
+    if (out != NULL && fclose(out) == EOF) {
+        perror(outPath);
+        exit(EXIT_FAILURE);
+    }
+
+    printf("msqid %d: %ld messages, %ld bytes\n", msqid, total, bytes);
+
+    if (maxMessages > 0 && total == maxMessages) {
+        printf("(stopped at -n %ld, the queue held %ld when we started)\n",
+               maxMessages, (long) ds.msg_qnum);
+    }
+
+    printf("\nBy type (top 20):\n");
+    qsort(types, TYPE_SLOTS, sizeof(types[0]), cmpType);
+
+    for (j = 0; j < 20 && types[j].count > 0; j++) {
+        printf("  type %-10ld %8ld msgs %10ld bytes ", types[j].mtype, types[j].count, types[j].bytes);
+        bar(types[j].count, total);
+        putchar('\n');
+    }
+
+    if (otherTypes > 0) {
+        printf("  (%ld messages in types beyond the first %d)\n", otherTypes, TYPE_SLOTS);
+    }
+
+    printf("\nBy size:\n");
+
+    for (j = 0; j < SIZE_BUCKETS; j++) {
+        if (sizes[j] > 0) {
+            if (j == SIZE_BUCKETS - 1) { /* Everything from 1024 up */
+                printf("  %5ld..      %8ld ", 1L << (j - 1), sizes[j]);
+            } else {
+                printf("  %5ld..%-5ld %8ld ", j ? 1L << (j - 1) : 0L, j ? (1L << j) - 1 : 0L, sizes[j]);
+            }
+            bar(sizes[j], total);
+            putchar('\n');
+        }
+    }
+
+    printf("\nBy age:\n");
+
+    for (j = 0; j < AGE_BUCKETS; j++) {
+        if (ages[j] > 0) {
+            printf("  %-8s %8ld ", ageNames[j], ages[j]);
+            bar(ages[j], total);
+            putchar('\n');
+        }
+    }
+
+    if (unknownAge > 0) {
+        printf("  %-8s %8ld (no timestamp header)\n", "unknown", unknownAge);
+    }
+
+    exit(EXIT_SUCCESS);
+}
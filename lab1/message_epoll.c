@@ -0,0 +1,128 @@
+/*
+ * Compile: gcc -o message_epoll message_epoll.c init_queue_mq.c -lrt
+ * Run: ./message_epoll
+ *      then send with a program linked against init_queue_mq.c, and connect
+ *      network clients with: nc localhost 5556
+ *
+ * One epoll loop serving the message queue and TCP clients together.
+ * Needs the POSIX backend; with init_queue.c queue_fd() returns -1.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/msg.h>
+#include <sys/socket.h>
+#include "message_queue.h"
+
+#define PORT 5556
+#define MAX_EVENTS 16
+#define BUF_SIZE 1024
+
+static void addFd(int epfd, int fd)
+{
+    struct epoll_event ev;
+
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+        perror("epoll_ctl");
+        exit(EXIT_FAILURE);
+    }
+}
+
+int main()
+{
+    struct epoll_event events[MAX_EVENTS];
+    struct sockaddr_in addr;
+    struct mbuf msg;
+    char buf[BUF_SIZE];
+    int msqid, qfd, sfd, epfd, ready, j, one = 1;
+    ssize_t n;
+
+    msqid = init_queue();
+    qfd = queue_fd(msqid);
+
+    if (qfd == -1) {
+        fprintf(stderr, "Queue backend cannot be polled, link with init_queue_mq.c\n");
+        exit(EXIT_FAILURE);
+    }
+
+    sfd = socket(AF_INET, SOCK_STREAM, 0);
+
+    if (sfd == -1) {
+        perror("socket");
+        exit(EXIT_FAILURE);
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(PORT);
+    addr.sin_addr.s_addr = INADDR_ANY;
+    setsockopt(sfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    if (bind(sfd, (struct sockaddr *) &addr, sizeof(addr)) == -1 || listen(sfd, 5) == -1) {
+        perror("bind/listen");
+        exit(EXIT_FAILURE);
+    }
+
+    epfd = epoll_create1(0);
+
+    if (epfd == -1) {
+        perror("epoll_create1");
+        exit(EXIT_FAILURE);
+    }
+
+    addFd(epfd, qfd);
+    addFd(epfd, sfd);
+    printf("Serving queue %s and port %d\n", MQ_NAME, PORT);
+
+    for (;;) {
+        ready = epoll_wait(epfd, events, MAX_EVENTS, -1);
+
+        if (ready == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            perror("epoll_wait");
+            exit(EXIT_FAILURE);
+        }
+
+        for (j = 0; j < ready; j++) {
+            int fd = events[j].data.fd;
+
+            if (fd == qfd) { /* Drain everything queued, never block the loop */
+                while ((n = queue_receive(msqid, &msg, MAX_MTEXT, 0, IPC_NOWAIT)) != -1) {
+                    printf("queue: type=%ld, length=%ld, text=%.*s\n",
+                           msg.mtype, (long) n, (int) n, msg.mtext);
+                }
+
+                if (errno != ENOMSG) {
+                    perror("queue_receive");
+                }
+            } else if (fd == sfd) {
+                int cfd = accept(sfd, NULL, NULL);
+
+                if (cfd != -1) {
+                    addFd(epfd, cfd);
+                }
+            } else {
+                n = read(fd, buf, sizeof(buf));
+
+                if (n <= 0) { /* Closing removes it from the epoll set */
+                    close(fd);
+                } else {
+                    printf("client %d: %.*s", fd, (int) n, buf);
+                }
+            }
+        }
+
+        fflush(stdout);
+    }
+}
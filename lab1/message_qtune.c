@@ -0,0 +1,127 @@
+/*
+ * Compile: gcc -o message_qtune message_qtune.c
+ * Run: ./message_qtune msqid min-bytes max-bytes [interval-ms]
+ *
+ * Long-running msg_qbytes tuner. Every interval it samples the queue with
+ * IPC_STAT and grows msg_qbytes when producers are being held back, or
+ * shrinks it again once the queue has stayed mostly empty for a while.
+ * Raising msg_qbytes above MSGMNB needs CAP_SYS_RESOURCE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/msg.h>
+#include "message_queue.h"
+
+#define HIGH_WATER 0.75 /* Fill ratio treated as backpressure */
+#define LOW_WATER 0.20 /* Fill ratio treated as idle */
+#define SHRINK_AFTER 20 /* Consecutive idle samples before shrinking */
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void stopHandler(int sig)
+{
+    stopRequested = 1;
+}
+
+static void logDecision(int msqid, const char *what, unsigned long from,
+                        unsigned long to, const struct msqid_ds *ds)
+{
+    char stamp[32];
+    time_t t = time(NULL);
+
+    strftime(stamp, sizeof(stamp), "%F %T", localtime(&t));
+    printf("%s msqid=%d %s qbytes %lu -> %lu (qnum=%lu cbytes=%lu)\n",
+           stamp, msqid, what, from, to,
+           (unsigned long) ds->msg_qnum, (unsigned long) ds->msg_cbytes);
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned long minBytes, maxBytes, cur, next;
+    struct msqid_ds ds;
+    struct timespec interval;
+    int msqid, idle = 0;
+    long intervalMs;
+    double fill;
+
+    if (argc < 4 || strcmp(argv[1], "--help") == 0) {
+        fprintf(stderr, "Usage: %s msqid min-bytes max-bytes [interval-ms]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    msqid = atoi(argv[1]);
+    minBytes = strtoul(argv[2], NULL, 0);
+    maxBytes = strtoul(argv[3], NULL, 0);
+    intervalMs = (argc > 4) ? atol(argv[4]) : 100;
+
+    if (minBytes < MAX_MTEXT || maxBytes < minBytes || intervalMs <= 0) {
+        fprintf(stderr, "Need MAX_MTEXT (%d) <= min-bytes <= max-bytes and interval > 0\n", MAX_MTEXT);
+        exit(EXIT_FAILURE);
+    }
+
+    interval.tv_sec = intervalMs / 1000;
+    interval.tv_nsec = (intervalMs % 1000) * 1000000L;
+    signal(SIGINT, stopHandler);
+    signal(SIGTERM, stopHandler);
+
+    while (!stopRequested) {
+        if (msgctl(msqid, IPC_STAT, &ds) == -1) {
+            fprintf(stderr, "msgctl error: %s\n", strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+
+        cur = ds.msg_qbytes;
+        next = cur;
+        fill = (cur > 0) ? (double) ds.msg_cbytes / cur : 1.0;
+
+        /* Backpressure: queue nearly full, or (on a queue under 4 messages
+           of MAX_MTEXT) no room left for the largest message */
+        if (fill >= HIGH_WATER || cur - ds.msg_cbytes < MAX_MTEXT) {
+            next = (cur * 2 > maxBytes) ? maxBytes : cur * 2;
+            idle = 0;
+        } else if (fill <= LOW_WATER) {
+            if (++idle >= SHRINK_AFTER) {
+                next = cur / 2;
+
+                if (next < ds.msg_cbytes * 2) { /* Leave room for what is queued */
+                    next = ds.msg_cbytes * 2;
+                }
+
+                if (next < minBytes) {
+                    next = minBytes;
+                }
+
+                idle = 0;
+            }
+        } else {
+            idle = 0;
+        }
+
+        if (cur < minBytes) {
+            next = minBytes;
+        } else if (cur > maxBytes) {
+            next = maxBytes;
+        }
+
+        if (next != cur) {
+            ds.msg_qbytes = next;
+
+            if (msgctl(msqid, IPC_SET, &ds) == -1) {
+                fprintf(stderr, "msgctl IPC_SET %lu: %s\n", next, strerror(errno));
+            } else {
+                logDecision(msqid, next > cur ? "grow" : "shrink", cur, next, &ds);
+            }
+        }
+
+        nanosleep(&interval, NULL);
+    }
+
+    exit(EXIT_SUCCESS);
+}
@@ -1,9 +1,30 @@
+#ifndef MESSAGE_QUEUE_H
+#define MESSAGE_QUEUE_H /* Prevent accidental double inclusion */
+
+#include <stddef.h>
+#include <sys/types.h>
+
 #define MSQ_ID 15 /* Message queue ID */
 #define MAX_MTEXT 1024 /* Maximum message size in bytes */
+#define MQ_NAME "/msq15" /* Queue name used by the POSIX backend */
+#define MQ_MAXMSG 10 /* POSIX backend capacity, see /proc/sys/fs/mqueue/msg_max */
 
 struct mbuf {
     long mtype; /* Message type */
     char mtext[MAX_MTEXT]; /* Message body */
 };
 
+/* Implemented twice, pick one at link time:
+   init_queue.c - System V queue (msgget/msgsnd/msgrcv)
+   init_queue_mq.c - POSIX queue (mq_open/mq_timedsend/mq_timedreceive, -lrt)
+   Flags are the System V ones (IPC_NOWAIT, MSG_NOERROR) for both backends.
+   The POSIX backend only supports type 0 (first message) on receive and
+   fails other types with EINVAL; programs that select by type check
+   queue_has_types() and fall back to type 0. */
 int init_queue();
+int queue_send(int msqid, const struct mbuf *msg, size_t len, int flags);
+ssize_t queue_receive(int msqid, struct mbuf *msg, size_t maxBytes, long type, int flags);
+int queue_fd(int msqid); /* Descriptor for select/epoll, -1 if not pollable */
+int queue_has_types(void); /* 1 if queue_receive() can select by type */
+
+#endif
@@ -1,19 +1,26 @@
+/*
+ * Compile: gcc -o message_receive message_receive.c msg_ttl.c init_queue.c
+ *      or: gcc -o message_receive message_receive.c msg_ttl.c init_queue_mq.c -lrt
+ * Run: ./message_receive
+ */
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/msg.h>
-#include "message_queue.h"
+#include "msg_ttl.h"
 
 int main()
 {
     int msqid = init_queue();
-    int type = 100;
+    int type = queue_has_types() ? 100 : 0; /* POSIX backend: first message */
     size_t maxBytes = MAX_MTEXT;
     ssize_t msgLen;
-    struct mbuf msg; /* Message buffer for msgrcv() */
-    msgLen = msgrcv(msqid, &msg, maxBytes, type, 0);
+    struct mbuf msg; /* Message buffer for ttlRecv() */
+    struct ttl_stats st = { 0 };
+    msgLen = ttlRecv(msqid, &msg, maxBytes, type, 0, &st); /* Skips expired messages */
 
     if (msgLen == -1) {
-        fprintf(stderr, "msgrcv");
+        fprintf(stderr, "ttlRecv");
         exit(-1);
     }
 
@@ -23,6 +30,10 @@ int main()
         printf("; body=%s", msg.mtext);
     }
 
+    if (st.shed > 0) {
+        printf("; expired messages dropped=%ld", st.shed);
+    }
+
     printf("\n");
     exit(EXIT_SUCCESS);
 }
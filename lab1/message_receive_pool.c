@@ -0,0 +1,60 @@
+/*
+ * Compile: gcc -o message_receive_pool message_receive_pool.c msg_pool.c init_queue.c -lpthread
+ * Run: ./message_receive_pool nworkers   (Ctrl+C drains the shards and stops)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <unistd.h>
+#include "msg_pool.h"
+
+static volatile sig_atomic_t stopRequested = 0;
+
+static void stopHandler(int sig)
+{
+    stopRequested = 1;
+}
+
+static void printMessage(int worker, const struct mbuf *msg, size_t len, void *arg)
+{
+    printf("worker %d: type=%ld, length=%zu, text=%.*s\n",
+           worker, msg->mtype, len, (int) len, msg->mtext);
+}
+
+int main(int argc, char *argv[])
+{
+    struct msg_pool pool;
+    int msqid, nworkers, j;
+
+    if (argc != 2 || (nworkers = atoi(argv[1])) < 1 || nworkers > POOL_MAX_WORKERS) {
+        fprintf(stderr, "Usage: %s nworkers (1..%d)\n", argv[0], POOL_MAX_WORKERS);
+        exit(EXIT_FAILURE);
+    }
+
+    msqid = init_queue();
+    signal(SIGINT, stopHandler);
+    signal(SIGTERM, stopHandler);
+
+    if (poolStart(&pool, msqid, nworkers, printMessage, NULL) == -1) {
+        perror("poolStart");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("Consuming queue %d with %d workers (mtypes %d..%d)\n",
+           msqid, nworkers, POOL_BASE_TYPE, POOL_BASE_TYPE + nworkers - 1);
+
+    while (!stopRequested) {
+        pause();
+    }
+
+    if (poolStop(&pool) == -1) {
+        perror("poolStop");
+    }
+
+    for (j = 0; j < nworkers; j++) {
+        printf("worker %d handled %ld messages\n", j, pool.handled[j]);
+    }
+
+    exit(EXIT_SUCCESS);
+}
@@ -12,8 +12,8 @@ int main()
     msg.mtype = 20;
     strcpy(msg.mtext, "test");
 
-    if (msgsnd(msqid, &msg, strlen(msg.mtext) + 1, 0) == -1) {
-        perror("msgsnd");
+    if (queue_send(msqid, &msg, strlen(msg.mtext) + 1, 0) == -1) {
+        perror("queue_send");
         exit(EXIT_FAILURE);
     }
 
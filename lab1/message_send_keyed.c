@@ -0,0 +1,32 @@
+/*
+ * Compile: gcc -o message_send_keyed message_send_keyed.c msg_pool.c init_queue.c -lpthread
+ * Run: ./message_send_keyed nshards key text...
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "msg_pool.h"
+
+int main(int argc, char *argv[])
+{
+    int msqid, nshards, j;
+
+    if (argc < 4 || (nshards = atoi(argv[1])) < 1) {
+        fprintf(stderr, "Usage: %s nshards key text...\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    msqid = init_queue();
+
+    for (j = 3; j < argc; j++) {
+        if (poolSend(msqid, nshards, argv[2], strlen(argv[2]), argv[j], strlen(argv[j]) + 1) == -1) {
+            perror("poolSend");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    printf("Sent %d messages: key=%s, type=%ld\n",
+           argc - 3, argv[2], poolRouteType(argv[2], strlen(argv[2]), nshards));
+    exit(EXIT_SUCCESS);
+}
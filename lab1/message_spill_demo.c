@@ -0,0 +1,115 @@
+/*
+ * Compile: gcc -o message_spill_demo message_spill_demo.c msg_spill.c -lpthread
+ * Run: ./message_spill_demo [messages] [journal-path]
+ *
+ * Like home1/ex9.c the queue gets a tiny msg_qbytes, but the producer sends
+ * through the spill layer: it never blocks, overflow goes to the journal and
+ * is re-injected in order while a slow consumer catches up.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/msg.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "msg_spill.h"
+
+#define QBYTES 2048 /* Room for a couple of hundred records */
+
+static long long nowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void consumer(int msqid, long messages)
+{
+    struct mbuf msg;
+    long seq, outOfOrder = 0;
+
+    for (long j = 0; j < messages; j++) {
+        if (msgrcv(msqid, &msg, MAX_MTEXT, 0, 0) == -1) {
+            perror("msgrcv");
+            _exit(EXIT_FAILURE);
+        }
+
+        memcpy(&seq, msg.mtext, sizeof(seq));
+        outOfOrder += (seq != j);
+
+        if (j % 64 == 0) {
+            usleep(1000); /* Slow consumer */
+        }
+    }
+
+    printf("consumer: %ld messages, %ld out of order\n", messages, outOfOrder);
+    fflush(stdout);
+    _exit(outOfOrder == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+    long messages = (argc > 1) ? atol(argv[1]) : 20000;
+    const char *path = (argc > 2) ? argv[2] : "msq_spill.journal";
+    long long start, t, worst = 0;
+    struct msg_spill spill;
+    struct msqid_ds ds;
+    struct mbuf msg;
+    int msqid, status;
+    pid_t child;
+
+    msqid = msgget(IPC_PRIVATE, IPC_CREAT | S_IRUSR | S_IWUSR);
+
+    if (msqid == -1 || msgctl(msqid, IPC_STAT, &ds) == -1) {
+        fprintf(stderr, "msgget/msgctl error");
+        exit(EXIT_FAILURE);
+    }
+
+    ds.msg_qbytes = QBYTES;
+
+    if (msgctl(msqid, IPC_SET, &ds) == -1) {
+        fprintf(stderr, "msgctl IPC_SET error");
+        exit(EXIT_FAILURE);
+    }
+
+    if ((child = fork()) == 0) {
+        consumer(msqid, messages);
+    }
+
+    if (spillOpen(&spill, msqid, path, 16 * 1024 * 1024) == -1) {
+        perror("spillOpen");
+        exit(EXIT_FAILURE);
+    }
+
+    msg.mtype = 1;
+    start = nowNs();
+
+    for (long j = 0; j < messages; j++) {
+        memcpy(msg.mtext, &j, sizeof(j));
+        t = nowNs();
+
+        if (spillSend(&spill, &msg, sizeof(j)) == -1) {
+            perror("spillSend");
+            exit(EXIT_FAILURE);
+        }
+
+        t = nowNs() - t;
+        worst = (t > worst) ? t : worst;
+    }
+
+    printf("producer: %ld messages in %.3f ms, worst send %.1f us\n",
+           messages, (nowNs() - start) / 1e6, worst / 1e3);
+    printf("producer: %ld direct, %ld spilled\n", spill.direct, spill.spilled);
+
+    spillClose(&spill);
+    waitpid(child, &status, 0);
+    printf("drain: %ld re-injected\n", spill.reinjected);
+
+    msgctl(msqid, IPC_RMID, NULL);
+    unlink(path);
+    exit(WIFEXITED(status) ? WEXITSTATUS(status) : EXIT_FAILURE);
+}
@@ -0,0 +1,188 @@
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/msg.h>
+#include "msg_batch.h"
+#include "lz_codec.h"
+
+static long long nowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void putU16(char *p, unsigned v)
+{
+    uint16_t u = v;
+    memcpy(p, &u, sizeof(u));
+}
+
+static unsigned getU16(const char *p)
+{
+    uint16_t u;
+    memcpy(&u, p, sizeof(u));
+    return u;
+}
+
+static void batchReset(struct mbatch *b)
+{
+    b->count = 0;
+    b->len = BATCH_HDR_SIZE;
+    b->deadline = 0;
+}
+
+int batchInit(struct mbatch *b, int msqid, long mtype, long flushUsec)
+{
+    if (mtype <= 0 || flushUsec < 0) { /* msgsnd() rejects mtype < 1 */
+        errno = EINVAL;
+        return -1;
+    }
+
+    b->msqid = msqid;
+    b->mtype = mtype;
+    b->flushUsec = flushUsec;
+    b->msgflg = 0;
+    b->compress = 0;
+    b->rawBytes = b->sentBytes = 0;
+    b->msg.mtype = mtype;
+    b->packed.mtype = mtype;
+    batchReset(b);
+
+    return 0;
+}
+
+int batchFlush(struct mbatch *b) /* Send whatever is packed, even one record */
+{
+    struct mbuf *out = &b->msg;
+    size_t outLen = b->len, c = 0;
+
+    if (b->count == 0) {
+        return 0;
+    }
+
+    if (b->compress) {
+        c = lzCompress(b->msg.mtext + BATCH_HDR_SIZE, b->len - BATCH_HDR_SIZE,
+                       b->packed.mtext + BATCH_HDR_SIZE, MAX_MTEXT - BATCH_HDR_SIZE);
+    }
+
+    if (c > 0) {
+        out = &b->packed;
+        outLen = BATCH_HDR_SIZE + c;
+    }
+
+    putU16(out->mtext, b->count);
+    putU16(out->mtext + 2, (c > 0) ? BATCH_FLAG_LZ : 0);
+
+    if (msgsnd(b->msqid, out, outLen, b->msgflg) == -1) {
+        return -1; /* Batch is kept, caller may retry */
+    }
+
+    b->rawBytes += b->len;
+    b->sentBytes += outLen;
+    batchReset(b);
+    return 0;
+}
+
+/* Returns -1 only if the record was not taken: too large, or the full
+   batch ahead of it could not be sent (EAGAIN with IPC_NOWAIT), so retrying
+   the same record never duplicates it. Once a record is packed the call
+   returns 0; if sending the batch right after that fails, the batch stays
+   and the next batchAppend(), batchPoll() or batchFlush() reports it. */
+int batchAppend(struct mbatch *b, const void *rec, size_t len)
+{
+    if (len > BATCH_MAX_RECORD) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    /* Flush first if the record does not fit in what is left */
+    if (b->len + BATCH_REC_HDR_SIZE + len > MAX_MTEXT && batchFlush(b) == -1) {
+        return -1;
+    }
+
+    putU16(b->msg.mtext + b->len, len);
+    memcpy(b->msg.mtext + b->len + BATCH_REC_HDR_SIZE, rec, len);
+    b->len += BATCH_REC_HDR_SIZE + len;
+
+    if (b->count++ == 0 && b->flushUsec > 0) {
+        b->deadline = nowNs() + b->flushUsec * 1000LL;
+    }
+
+    /* A full batch cannot take even an empty record, try to send it now */
+    if (b->len + BATCH_REC_HDR_SIZE > MAX_MTEXT) {
+        batchFlush(b);
+    } else {
+        batchPoll(b);
+    }
+
+    return 0; /* Buffered; see above for a send that failed here */
+}
+
+int batchPoll(struct mbatch *b) /* Flush if the oldest record is overdue */
+{
+    if (b->count == 0 || b->deadline == 0 || nowNs() < b->deadline) {
+        return 0;
+    }
+
+    return batchFlush(b);
+}
+
+ssize_t batchRecv(struct mbatch_iter *it, int msqid, long mtype, int msgflg)
+{
+    ssize_t msgLen = msgrcv(msqid, &it->msg, MAX_MTEXT, mtype, msgflg);
+
+    if (msgLen == -1) {
+        return -1;
+    }
+
+    if (msgLen < BATCH_HDR_SIZE) { /* Not produced by batchFlush() */
+        errno = EBADMSG;
+        return -1;
+    }
+
+    it->base = it->msg.mtext + BATCH_HDR_SIZE;
+    it->len = msgLen - BATCH_HDR_SIZE;
+    it->pos = 0;
+    it->left = getU16(it->msg.mtext);
+    it->flags = getU16(it->msg.mtext + 2);
+
+    if (it->flags & BATCH_FLAG_LZ) {
+        ssize_t n = lzDecompress(it->base, it->len, it->raw, sizeof(it->raw));
+
+        if (n == -1) {
+            return -1;
+        }
+
+        it->base = it->raw;
+        it->len = n;
+    }
+
+    return it->left;
+}
+
+const void *batchNext(struct mbatch_iter *it, size_t *len)
+{
+    size_t recLen;
+    const char *rec;
+
+    if (it->left == 0 || it->pos + BATCH_REC_HDR_SIZE > it->len) {
+        return NULL;
+    }
+
+    recLen = getU16(it->base + it->pos);
+    rec = it->base + it->pos + BATCH_REC_HDR_SIZE;
+
+    if (it->pos + BATCH_REC_HDR_SIZE + recLen > it->len) { /* Truncated */
+        it->left = 0;
+        return NULL;
+    }
+
+    it->pos += BATCH_REC_HDR_SIZE + recLen;
+    it->left--;
+    *len = recLen;
+
+    return rec;
+}
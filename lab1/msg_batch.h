@@ -0,0 +1,50 @@
+#ifndef MSG_BATCH_H
+#define MSG_BATCH_H /* Prevent accidental double inclusion */
+
+#include <stddef.h>
+#include <sys/types.h>
+#include "message_queue.h"
+
+/* Layout of a batched message body:
+       [count:2][flags:2] then count x [len:2][len bytes]
+   All integers are in host byte order, the queue never leaves the machine.
+   With BATCH_FLAG_LZ set, everything after the header is one lz_codec block
+   that expands to the record list. */
+#define BATCH_HDR_SIZE 4 /* count + flags */
+#define BATCH_FLAG_LZ 0x1
+#define BATCH_REC_HDR_SIZE 2 /* Per-record length prefix */
+#define BATCH_MAX_RECORD (MAX_MTEXT - BATCH_HDR_SIZE - BATCH_REC_HDR_SIZE)
+
+struct mbatch { /* Producer side: records waiting to be sent */
+    int msqid;
+    long mtype; /* Type used for every batch message */
+    long flushUsec; /* Max age of the oldest unsent record, 0 = size only */
+    long long deadline; /* CLOCK_MONOTONIC ns when the batch must go out */
+    unsigned count; /* Records packed so far */
+    size_t len; /* Bytes used in msg.mtext, header included */
+    int msgflg; /* Extra flags for msgsnd(), e.g. IPC_NOWAIT */
+    int compress; /* Try lz_codec on each batch, sent raw if it does not shrink */
+    long rawBytes, sentBytes; /* Record bytes packed / bytes handed to msgsnd() */
+    struct mbuf msg;
+    struct mbuf packed; /* Compressed copy of msg */
+};
+
+struct mbatch_iter { /* Consumer side: unpacks one received batch */
+    const char *base; /* Record list, in msg or in raw */
+    size_t len; /* Bytes in the record list */
+    size_t pos; /* Offset of the next record */
+    unsigned left; /* Records not yet returned */
+    unsigned flags; /* Flags from the batch header */
+    struct mbuf msg;
+    char raw[MAX_MTEXT]; /* Record list of a compressed batch */
+};
+
+int batchInit(struct mbatch *b, int msqid, long mtype, long flushUsec);
+int batchAppend(struct mbatch *b, const void *rec, size_t len); /* -1: record not taken */
+int batchPoll(struct mbatch *b);
+int batchFlush(struct mbatch *b);
+
+ssize_t batchRecv(struct mbatch_iter *it, int msqid, long mtype, int msgflg);
+const void *batchNext(struct mbatch_iter *it, size_t *len);
+
+#endif
@@ -0,0 +1,173 @@
+/*
+ * Compile: gcc -O2 -o msg_batch_bench msg_batch_bench.c msg_batch.c lz_codec.c
+ * Run: ./msg_batch_bench [records] [record-size] [flush-usec]
+ *
+ * Sends the same stream of small records three times through a private queue:
+ * once with one msgsnd()/msgrcv() per record, once packed by msg_batch,
+ * and once packed and compressed with lz_codec. Records start with the
+ * counter, so neighbours differ even at the default size of 5 bytes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/msg.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "msg_batch.h"
+
+#define REC_TYPE 20
+
+static double nowSec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void consumeSingle(int msqid, long records)
+{
+    struct mbuf msg;
+
+    for (long j = 0; j < records; j++) {
+        if (msgrcv(msqid, &msg, MAX_MTEXT, REC_TYPE, 0) == -1) {
+            perror("msgrcv");
+            _exit(EXIT_FAILURE);
+        }
+    }
+}
+
+static void consumeBatched(int msqid, long records)
+{
+    struct mbatch_iter it;
+    size_t len;
+
+    for (long j = 0; j < records; ) {
+        if (batchRecv(&it, msqid, REC_TYPE, 0) == -1) {
+            perror("batchRecv");
+            _exit(EXIT_FAILURE);
+        }
+
+        while (batchNext(&it, &len) != NULL) {
+            j++;
+        }
+    }
+}
+
+static double compressRatio;
+
+/* Event-like text that differs between neighbours at any size: it starts
+   with the low digits of the counter, so even the default 5-byte record is
+   "0042" and not a constant prefix */
+static void makeRecord(char *buf, size_t recSize, long j)
+{
+    unsigned seed = j;
+
+    snprintf(buf, recSize, "%04ld %s worker-%d latency=%uus id=%ld%*s", j % 10000,
+             rand_r(&seed) % 20 ? "OK" : "RETRY", rand_r(&seed) % 8, rand_r(&seed) % 5000,
+             j, (int) recSize, "");
+}
+
+static double runOnce(int msqid, long records, size_t recSize, long flushUsec,
+                      int batched, int compress)
+{
+    struct mbatch b;
+    struct mbuf msg;
+    double start;
+    pid_t child;
+
+    child = fork();
+
+    if (child == -1) {
+        perror("fork");
+        exit(EXIT_FAILURE);
+    }
+
+    if (child == 0) {
+        if (batched) {
+            consumeBatched(msqid, records);
+        } else {
+            consumeSingle(msqid, records);
+        }
+
+        _exit(EXIT_SUCCESS);
+    }
+
+    msg.mtype = REC_TYPE;
+    batchInit(&b, msqid, REC_TYPE, flushUsec);
+    b.compress = compress;
+    start = nowSec();
+
+    for (long j = 0; j < records; j++) {
+        makeRecord(msg.mtext, recSize, j);
+
+        int s = batched ? batchAppend(&b, msg.mtext, recSize)
+                        : msgsnd(msqid, &msg, recSize, 0);
+
+        if (s == -1) {
+            perror(batched ? "batchAppend" : "msgsnd");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (batched && batchFlush(&b) == -1) {
+        perror("batchFlush");
+        exit(EXIT_FAILURE);
+    }
+
+    if (waitpid(child, NULL, 0) == -1) {
+        perror("waitpid");
+        exit(EXIT_FAILURE);
+    }
+
+    if (batched) {
+        compressRatio = (double) b.rawBytes / b.sentBytes;
+    }
+
+    return nowSec() - start;
+}
+
+int main(int argc, char *argv[])
+{
+    long records = (argc > 1) ? atol(argv[1]) : 1000000;
+    size_t recSize = (argc > 2) ? (size_t) atol(argv[2]) : 5; /* strlen("test") + 1 */
+    long flushUsec = (argc > 3) ? atol(argv[3]) : 1000;
+    double single, batched, packed;
+    int msqid;
+
+    if (records <= 0 || recSize > BATCH_MAX_RECORD) {
+        fprintf(stderr, "Usage: %s [records] [record-size <= %d] [flush-usec]\n",
+                argv[0], BATCH_MAX_RECORD);
+        exit(EXIT_FAILURE);
+    }
+
+    msqid = msgget(IPC_PRIVATE, IPC_CREAT | S_IRUSR | S_IWUSR);
+
+    if (msqid == -1) {
+        perror("msgget");
+        exit(EXIT_FAILURE);
+    }
+
+    single = runOnce(msqid, records, recSize, flushUsec, 0, 0);
+    batched = runOnce(msqid, records, recSize, flushUsec, 1, 0);
+    packed = runOnce(msqid, records, recSize, flushUsec, 1, 1);
+
+    printf("records=%ld size=%zu\n", records, recSize);
+    printf("one msg per record: %10.0f records/sec (%.3f s)\n", records / single, single);
+    printf("batched:            %10.0f records/sec (%.3f s, %zu records/msg)\n",
+           records / batched, batched,
+           (size_t) (MAX_MTEXT - BATCH_HDR_SIZE) / (BATCH_REC_HDR_SIZE + recSize));
+    printf("batched + lz:       %10.0f records/sec (%.3f s, %.2fx fewer queue bytes)\n",
+           records / packed, packed, compressRatio);
+    printf("speedup:            %10.2fx batched, %.2fx batched + lz\n",
+           single / batched, single / packed);
+
+    if (msgctl(msqid, IPC_RMID, NULL) == -1) {
+        perror("msgctl");
+    }
+
+    exit(EXIT_SUCCESS);
+}
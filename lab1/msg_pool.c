@@ -0,0 +1,118 @@
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <sys/msg.h>
+#include "msg_pool.h"
+
+long poolRouteType(const void *key, size_t keyLen, int nshards) /* FNV-1a */
+{
+    const unsigned char *p = key;
+    uint32_t h = 2166136261u;
+
+    for (size_t j = 0; j < keyLen; j++) {
+        h = (h ^ p[j]) * 16777619u;
+    }
+
+    return POOL_BASE_TYPE + (long) (h % (uint32_t) nshards);
+}
+
+int poolSend(int msqid, int nshards, const void *key, size_t keyLen,
+             const void *data, size_t len)
+{
+    struct mbuf msg;
+
+    if (len == 0 || len > MAX_MTEXT) { /* Empty messages are stop requests */
+        errno = EINVAL;
+        return -1;
+    }
+
+    msg.mtype = poolRouteType(key, keyLen, nshards);
+    memcpy(msg.mtext, data, len);
+
+    return msgsnd(msqid, &msg, len, 0);
+}
+
+static void *poolWorker(void *arg)
+{
+    struct pool_worker *w = arg;
+    struct msg_pool *p = w->pool;
+    long type = POOL_BASE_TYPE + w->index;
+    struct mbuf msg;
+    ssize_t msgLen;
+
+    for (;;) {
+        msgLen = msgrcv(p->msqid, &msg, MAX_MTEXT, type, 0);
+
+        if (msgLen == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            break; /* Queue removed (EIDRM) or unusable */
+        }
+
+        if (msgLen == 0) { /* Stop request from poolStop() */
+            break;
+        }
+
+        p->handler(w->index, &msg, msgLen, p->arg);
+        p->handled[w->index]++;
+    }
+
+    return NULL;
+}
+
+int poolStart(struct msg_pool *p, int msqid, int nworkers, pool_handler handler, void *arg)
+{
+    int j, s;
+
+    if (nworkers < 1 || nworkers > POOL_MAX_WORKERS || handler == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    p->msqid = msqid;
+    p->nworkers = 0;
+    p->handler = handler;
+    p->arg = arg;
+    memset(p->handled, 0, sizeof(p->handled));
+
+    for (j = 0; j < nworkers; j++) {
+        p->workers[j].pool = p;
+        p->workers[j].index = j;
+
+        s = pthread_create(&p->threads[j], NULL, poolWorker, &p->workers[j]);
+
+        if (s != 0) {
+            poolStop(p);
+            errno = s;
+            return -1;
+        }
+
+        p->nworkers++;
+    }
+
+    return 0;
+}
+
+int poolStop(struct msg_pool *p)
+{
+    struct mbuf msg;
+    int j, status = 0;
+
+    /* Stop requests queue up behind pending work, so each shard is drained */
+    for (j = 0; j < p->nworkers; j++) {
+        msg.mtype = POOL_BASE_TYPE + j;
+
+        if (msgsnd(p->msqid, &msg, 0, 0) == -1 && errno != EIDRM && errno != EINVAL) {
+            status = -1;
+        }
+    }
+
+    for (j = 0; j < p->nworkers; j++) {
+        pthread_join(p->threads[j], NULL);
+    }
+
+    p->nworkers = 0;
+    return status;
+}
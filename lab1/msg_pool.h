@@ -0,0 +1,39 @@
+#ifndef MSG_POOL_H
+#define MSG_POOL_H /* Prevent accidental double inclusion */
+
+#include <stddef.h>
+#include <pthread.h>
+#include "message_queue.h"
+
+/* Worker j of an N-worker pool blocks in msgrcv() on mtype POOL_BASE_TYPE + j.
+   A zero-length message on a shard is the stop request for its worker. */
+#define POOL_BASE_TYPE 1
+#define POOL_MAX_WORKERS 256
+
+typedef void (*pool_handler)(int worker, const struct mbuf *msg, size_t len, void *arg);
+
+struct msg_pool;
+
+struct pool_worker {
+    struct msg_pool *pool;
+    int index; /* Shard served: mtype POOL_BASE_TYPE + index */
+};
+
+struct msg_pool {
+    int msqid;
+    int nworkers;
+    pool_handler handler;
+    void *arg;
+    pthread_t threads[POOL_MAX_WORKERS];
+    struct pool_worker workers[POOL_MAX_WORKERS];
+    long handled[POOL_MAX_WORKERS]; /* Messages processed per worker */
+};
+
+long poolRouteType(const void *key, size_t keyLen, int nshards);
+int poolSend(int msqid, int nshards, const void *key, size_t keyLen,
+             const void *data, size_t len);
+
+int poolStart(struct msg_pool *p, int msqid, int nworkers, pool_handler handler, void *arg);
+int poolStop(struct msg_pool *p);
+
+#endif
@@ -0,0 +1,162 @@
+#define _GNU_SOURCE /* MSG_COPY */
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/msg.h>
+#include "msg_prio.h"
+
+static long long nowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int prioSend(int msqid, int lane, const void *data, size_t len, int msgflg)
+{
+    struct mbuf msg;
+    long long ts;
+
+    if (lane < 0 || lane >= PRIO_MAX_LANES || len > PRIO_MAX_PAYLOAD) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    msg.mtype = PRIO_BASE_TYPE + lane;
+    memcpy(msg.mtext + PRIO_HDR_SIZE, data, len);
+    ts = nowNs();
+    memcpy(msg.mtext, &ts, sizeof(ts));
+
+    return msgsnd(msqid, &msg, PRIO_HDR_SIZE + len, msgflg);
+}
+
+int prioInit(struct prio_rx *rx, int msqid, int nlanes, long agingMs)
+{
+    long long now = nowNs();
+
+    if (nlanes < 1 || nlanes > PRIO_MAX_LANES || agingMs < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    memset(rx, 0, sizeof(*rx));
+    rx->msqid = msqid;
+    rx->nlanes = nlanes;
+    rx->agingNs = agingMs * 1000000LL;
+
+    for (int j = 0; j < nlanes; j++) {
+        rx->lanes[j].lastServedNs = now;
+    }
+
+    return 0;
+}
+
+/* Copy the payload out and account the message to its lane */
+static ssize_t prioDeliver(struct prio_rx *rx, struct mbuf *msg, ssize_t msgLen,
+                           int *lane, void *data, size_t maxLen, long long now)
+{
+    struct prio_lane_stats *st;
+    long long sent, wait;
+    size_t len;
+    int l = msg->mtype - PRIO_BASE_TYPE;
+
+    if (msgLen < (ssize_t) PRIO_HDR_SIZE || l < 0 || l >= rx->nlanes) {
+        errno = EBADMSG;
+        return -1;
+    }
+
+    memcpy(&sent, msg->mtext, sizeof(sent));
+    len = msgLen - PRIO_HDR_SIZE;
+
+    if (len > maxLen) {
+        len = maxLen;
+    }
+
+    memcpy(data, msg->mtext + PRIO_HDR_SIZE, len);
+
+    st = &rx->lanes[l];
+    wait = now - sent;
+    st->received++;
+    st->waitTotalNs += wait;
+
+    if (wait > st->waitMaxNs) {
+        st->waitMaxNs = wait;
+    }
+
+    st->lastServedNs = now;
+    *lane = l;
+
+    return len;
+}
+
+ssize_t prioRecv(struct prio_rx *rx, int *lane, void *data, size_t maxLen, int msgflg)
+{
+    struct mbuf msg;
+    ssize_t msgLen;
+    long long now = nowNs(), oldest;
+    int j, starved;
+
+    /* Aging: the most starved lane other than 0 gets one non-blocking try
+       before strict priority order applies */
+    if (rx->agingNs > 0) {
+        starved = -1;
+        oldest = now - rx->agingNs;
+
+        for (j = 1; j < rx->nlanes; j++) {
+            if (rx->lanes[j].lastServedNs < oldest) {
+                oldest = rx->lanes[j].lastServedNs;
+                starved = j;
+            }
+        }
+
+        if (starved != -1) {
+            msgLen = msgrcv(rx->msqid, &msg, MAX_MTEXT, PRIO_BASE_TYPE + starved,
+                            IPC_NOWAIT | MSG_NOERROR);
+
+            if (msgLen != -1) {
+                rx->lanes[starved].promoted++;
+                return prioDeliver(rx, &msg, msgLen, lane, data, maxLen, now);
+            }
+
+            if (errno != ENOMSG) {
+                return -1;
+            }
+
+            rx->lanes[starved].lastServedNs = now; /* Empty lane is not starving */
+        }
+    }
+
+    msgLen = msgrcv(rx->msqid, &msg, MAX_MTEXT, -(PRIO_BASE_TYPE + rx->nlanes - 1),
+                    msgflg | MSG_NOERROR);
+
+    if (msgLen == -1) {
+        return -1;
+    }
+
+    return prioDeliver(rx, &msg, msgLen, lane, data, maxLen, nowNs());
+}
+
+/* Pending messages per lane, counted without consuming anything. Walks the
+   queue by index with MSG_COPY, one syscall per queued message, so it is
+   meant for monitoring rather than the receive path. MSG_COPY needs a kernel
+   built with CONFIG_CHECKPOINT_RESTORE and a buffer as large as the message. */
+int prioLaneDepths(int msqid, int nlanes, long *depths)
+{
+    struct mbuf msg;
+    long idx, l;
+
+    memset(depths, 0, nlanes * sizeof(depths[0]));
+
+    for (idx = 0; ; idx++) {
+        if (msgrcv(msqid, &msg, MAX_MTEXT, idx, MSG_COPY | IPC_NOWAIT) == -1) {
+            return (errno == ENOMSG) ? 0 : -1;
+        }
+
+        l = msg.mtype - PRIO_BASE_TYPE;
+
+        if (l >= 0 && l < nlanes) {
+            depths[l]++;
+        }
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef MSG_PRIO_H
+#define MSG_PRIO_H /* Prevent accidental double inclusion */
+
+#include <stddef.h>
+#include <sys/types.h>
+#include "message_queue.h"
+
+/* Lane L travels as mtype PRIO_BASE_TYPE + L, lane 0 is the most urgent.
+   A receive with msgtyp = -(highest lane type) lets the kernel hand out the
+   lowest pending type first. Every message starts with its send time. */
+#define PRIO_BASE_TYPE 1
+#define PRIO_MAX_LANES 16
+#define PRIO_HDR_SIZE sizeof(long long)
+#define PRIO_MAX_PAYLOAD (MAX_MTEXT - PRIO_HDR_SIZE)
+
+struct prio_lane_stats {
+    long received; /* Messages taken from this lane */
+    long promoted; /* Of those, taken early because the lane was starving */
+    long long waitTotalNs; /* Sum of send-to-receive times */
+    long long waitMaxNs;
+    long long lastServedNs; /* CLOCK_MONOTONIC time the lane was last served or found empty */
+};
+
+struct prio_rx { /* Receiver state, one per consuming thread */
+    int msqid;
+    int nlanes;
+    long long agingNs; /* A lane unserved this long is polled before the rest, 0 = off */
+    struct prio_lane_stats lanes[PRIO_MAX_LANES];
+};
+
+int prioSend(int msqid, int lane, const void *data, size_t len, int msgflg);
+int prioInit(struct prio_rx *rx, int msqid, int nlanes, long agingMs);
+ssize_t prioRecv(struct prio_rx *rx, int *lane, void *data, size_t maxLen, int msgflg);
+int prioLaneDepths(int msqid, int nlanes, long *depths);
+
+#endif
@@ -0,0 +1,373 @@
+#define _GNU_SOURCE /* gettid() */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/msg.h>
+#include "msg_rpc.h"
+
+static struct rpc_budget budgets[RPC_MAX_QUEUES];
+static pthread_mutex_t budgetLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t budgetFreed = PTHREAD_COND_INITIALIZER;
+
+/* The request behind a reply has left the queue */
+static void budgetRelease(struct rpc_client *c, size_t n)
+{
+    pthread_mutex_lock(&budgetLock);
+    c->reqBytes -= n;
+    c->budget->bytes -= n;
+    pthread_cond_broadcast(&budgetFreed);
+    pthread_mutex_unlock(&budgetLock);
+}
+
+int rpcClientInit(struct rpc_client *c, int msqid)
+{
+    struct rpc_budget *b = NULL;
+    struct msqid_ds ds;
+    int j;
+
+    if (msgctl(msqid, IPC_STAT, &ds) == -1) {
+        return -1;
+    }
+
+    c->replyType = gettid();
+
+    if (c->replyType == RPC_REQ_TYPE) { /* Only init could collide */
+        errno = EINVAL;
+        return -1;
+    }
+
+    pthread_mutex_lock(&budgetLock);
+
+    for (j = 0; j < RPC_MAX_QUEUES; j++) { /* This queue's budget, or a free one */
+        if (budgets[j].users > 0 && budgets[j].msqid == msqid) {
+            b = &budgets[j];
+            break;
+        }
+
+        if (budgets[j].users == 0 && b == NULL) {
+            b = &budgets[j];
+        }
+    }
+
+    if (b == NULL) {
+        pthread_mutex_unlock(&budgetLock);
+        errno = ENOSPC;
+        return -1;
+    }
+
+    if (b->users++ == 0) {
+        b->msqid = msqid;
+        b->bytes = 0;
+        b->max = ds.msg_qbytes / 2;
+    }
+
+    pthread_mutex_unlock(&budgetLock);
+
+    c->budget = b;
+    c->reqBytes = 0;
+    c->msqid = msqid;
+    c->nextId = 1;
+    c->inFlight = 0;
+    c->stashHead = c->stashTail = NULL;
+    c->stashed = 0;
+
+    return 0;
+}
+
+void rpcClientFree(struct rpc_client *c)
+{
+    while (c->stashHead != NULL) {
+        struct rpc_stash *s = c->stashHead;
+
+        c->stashHead = s->next;
+        free(s);
+    }
+
+    c->stashTail = NULL;
+    c->stashed = 0;
+
+    /* Replies never collected are no longer ours to wait for */
+    pthread_mutex_lock(&budgetLock);
+    c->budget->bytes -= c->reqBytes;
+    c->budget->users--;
+    c->reqBytes = 0;
+    pthread_cond_broadcast(&budgetFreed);
+    pthread_mutex_unlock(&budgetLock);
+}
+
+/* Blocks for one of our replies and keeps it for rpcCollect() */
+static int stashReply(struct rpc_client *c)
+{
+    struct mbuf msg;
+    struct rpc_stash *s;
+    ssize_t msgLen;
+
+    while ((msgLen = msgrcv(c->msqid, &msg, MAX_MTEXT, c->replyType, 0)) == -1) {
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+
+    if ((s = malloc(sizeof(*s) + msgLen)) == NULL) {
+        return -1; /* The reply is lost, as it would be on any receive error */
+    }
+
+    if (msgLen >= (ssize_t) sizeof(struct rpc_hdr)) {
+        struct rpc_hdr h;
+
+        memcpy(&h, msg.mtext, sizeof(h));
+        budgetRelease(c, h.reqBytes);
+    }
+
+    s->next = NULL;
+    s->len = msgLen;
+    memcpy(s->mtext, msg.mtext, msgLen);
+
+    if (c->stashTail == NULL) {
+        c->stashHead = s;
+    } else {
+        c->stashTail->next = s;
+    }
+
+    c->stashTail = s;
+    c->stashed++;
+    return 0;
+}
+
+int rpcSend(struct rpc_client *c, int op, const void *data, size_t len, uint32_t *corrId)
+{
+    struct mbuf msg;
+    struct rpc_hdr h;
+
+    if (len > RPC_MAX_PAYLOAD) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    h.corrId = c->nextId++;
+    h.op = op;
+    h.replyType = c->replyType;
+    h.reqBytes = sizeof(h) + len;
+    msg.mtype = RPC_REQ_TYPE;
+    memcpy(msg.mtext, &h, sizeof(h));
+    memcpy(msg.mtext + sizeof(h), data, len);
+
+    /* Leave at least half the queue for replies, see msg_rpc.h. A request
+       alone is always let through, whatever its size. */
+    pthread_mutex_lock(&budgetLock);
+
+    while (c->budget->bytes > 0 && c->budget->bytes + h.reqBytes > c->budget->max) {
+        if (c->inFlight > c->stashed) { /* Free some of it ourselves */
+            pthread_mutex_unlock(&budgetLock);
+
+            if (stashReply(c) == -1) {
+                return -1;
+            }
+
+            pthread_mutex_lock(&budgetLock);
+        } else { /* All of it belongs to other clients */
+            pthread_cond_wait(&budgetFreed, &budgetLock);
+        }
+    }
+
+    c->budget->bytes += h.reqBytes;
+    c->reqBytes += h.reqBytes;
+    pthread_mutex_unlock(&budgetLock);
+
+    /* Queue full anyway: if some of it is our replies, make room by taking
+       one. Only with nothing of ours left to take is it safe to block. */
+    while (msgsnd(c->msqid, &msg, sizeof(h) + len, IPC_NOWAIT) == -1) {
+        if (errno == EINTR) {
+            continue;
+        }
+
+        if (errno != EAGAIN) {
+            budgetRelease(c, h.reqBytes);
+            return -1;
+        }
+
+        if (c->inFlight == c->stashed) {
+            if (msgsnd(c->msqid, &msg, sizeof(h) + len, 0) == -1) {
+                budgetRelease(c, h.reqBytes);
+                return -1;
+            }
+
+            break;
+        }
+
+        if (stashReply(c) == -1) {
+            budgetRelease(c, h.reqBytes);
+            return -1;
+        }
+    }
+
+    c->inFlight++;
+
+    if (corrId != NULL) {
+        *corrId = h.corrId;
+    }
+
+    return 0;
+}
+
+/* Takes the next reply for this client, whichever request it answers */
+ssize_t rpcCollect(struct rpc_client *c, uint32_t *corrId, int *status,
+                   void *data, size_t maxLen, int msgflg)
+{
+    struct mbuf msg;
+    struct rpc_hdr h;
+    struct rpc_stash *s = c->stashHead;
+    ssize_t msgLen;
+    size_t len;
+
+    if (s != NULL) { /* Arrived while rpcSend() was making room */
+        c->stashHead = s->next;
+        c->stashTail = (c->stashHead == NULL) ? NULL : c->stashTail;
+        c->stashed--;
+        msgLen = s->len;
+        memcpy(msg.mtext, s->mtext, msgLen);
+        free(s);
+    } else if ((msgLen = msgrcv(c->msqid, &msg, MAX_MTEXT, c->replyType, msgflg)) == -1) {
+        return -1;
+    } else if (msgLen >= (ssize_t) sizeof(h)) {
+        memcpy(&h, msg.mtext, sizeof(h));
+        budgetRelease(c, h.reqBytes);
+    }
+
+    if (msgLen < (ssize_t) sizeof(h)) {
+        errno = EBADMSG;
+        return -1;
+    }
+
+    memcpy(&h, msg.mtext, sizeof(h));
+    len = msgLen - sizeof(h);
+    len = (len > maxLen) ? maxLen : len;
+    memcpy(data, msg.mtext + sizeof(h), len);
+    c->inFlight--;
+
+    if (corrId != NULL) {
+        *corrId = h.corrId;
+    }
+
+    if (status != NULL) {
+        *status = h.op;
+    }
+
+    return len;
+}
+
+/* Synchronous call; only valid with nothing else in flight */
+ssize_t rpcCall(struct rpc_client *c, int op, const void *req, size_t reqLen,
+                void *reply, size_t maxReply, int *status)
+{
+    if (c->inFlight != 0) {
+        errno = EBUSY;
+        return -1;
+    }
+
+    if (rpcSend(c, op, req, reqLen, NULL) == -1) {
+        return -1;
+    }
+
+    return rpcCollect(c, NULL, status, reply, maxReply, 0);
+}
+
+static void *serverThread(void *arg)
+{
+    struct rpc_server *s = arg;
+    struct mbuf req, rep;
+    struct rpc_hdr h;
+    ssize_t msgLen, repLen;
+    int status;
+
+    for (;;) {
+        msgLen = msgrcv(s->msqid, &req, MAX_MTEXT, RPC_REQ_TYPE, 0);
+
+        if (msgLen == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            break; /* Queue removed */
+        }
+
+        if (msgLen == 0) { /* Stop request from rpcStop() */
+            break;
+        }
+
+        if (msgLen < (ssize_t) sizeof(h)) {
+            continue; /* Nobody to reply to */
+        }
+
+        memcpy(&h, req.mtext, sizeof(h));
+        status = 0;
+        repLen = s->handler(h.op, req.mtext + sizeof(h), msgLen - sizeof(h),
+                            rep.mtext + sizeof(h), RPC_MAX_PAYLOAD, &status, s->arg);
+
+        if (repLen < 0) {
+            repLen = 0;
+            status = (status != 0) ? status : -1;
+        }
+
+        h.op = status;
+        memcpy(rep.mtext, &h, sizeof(h));
+        rep.mtype = h.replyType;
+
+        while (msgsnd(s->msqid, &rep, sizeof(h) + repLen, 0) == -1 && errno == EINTR) {
+            continue;
+        }
+    }
+
+    return NULL;
+}
+
+int rpcServe(struct rpc_server *s, int msqid, int nthreads, rpc_handler handler, void *arg)
+{
+    int j, e;
+
+    if (nthreads < 1 || nthreads > RPC_MAX_THREADS || handler == NULL) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    s->msqid = msqid;
+    s->handler = handler;
+    s->arg = arg;
+    s->nthreads = 0;
+
+    for (j = 0; j < nthreads; j++) {
+        e = pthread_create(&s->threads[j], NULL, serverThread, s);
+
+        if (e != 0) {
+            rpcStop(s);
+            errno = e;
+            return -1;
+        }
+
+        s->nthreads++;
+    }
+
+    return 0;
+}
+
+int rpcStop(struct rpc_server *s)
+{
+    struct mbuf msg;
+    int j, status = 0;
+
+    msg.mtype = RPC_REQ_TYPE;
+
+    for (j = 0; j < s->nthreads; j++) { /* One stop request per thread */
+        if (msgsnd(s->msqid, &msg, 0, 0) == -1) {
+            status = -1;
+        }
+    }
+
+    for (j = 0; j < s->nthreads; j++) {
+        pthread_join(s->threads[j], NULL);
+    }
+
+    s->nthreads = 0;
+    return status;
+}
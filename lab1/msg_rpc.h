@@ -0,0 +1,90 @@
+#ifndef MSG_RPC_H
+#define MSG_RPC_H /* Prevent accidental double inclusion */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include "message_queue.h"
+
+/* Requests travel as mtype RPC_REQ_TYPE. Each client thread receives its
+   replies on mtype = its thread ID (the PID for a single-threaded client),
+   and a correlation ID in the header pairs replies with requests, so a
+   client may keep many requests in flight and collect replies in any order.
+   A zero-length request asks one server thread to exit.
+
+   Requests and replies share the queue. If requests could fill
+   msg_qbytes, the server threads would block sending replies while the
+   clients block sending more requests or waiting for those replies.
+   rpcSend() therefore keeps the bytes of unanswered requests under half
+   of msg_qbytes, a budget shared by every client of the process on that
+   queue: a client over it takes its own replies off the queue into a
+   local stash, or waits for other clients to collect theirs.
+   rpcCollect() hands stashed replies out first. Sends use IPC_NOWAIT and
+   make room the same way when other traffic fills the queue.
+
+   The budget counts request bytes only, so it assumes replies are not
+   much larger than their requests; and it is per process, so client
+   processes sharing one queue must stay under msg_qbytes together by
+   other means (or each use their own queue). */
+#define RPC_REQ_TYPE 1
+#define RPC_MAX_THREADS 64
+#define RPC_MAX_QUEUES 16 /* Queues with clients in one process */
+
+struct rpc_hdr {
+    uint32_t corrId;
+    int32_t op; /* Request: operation code. Reply: handler status */
+    int64_t replyType; /* mtype the reply is sent with */
+    uint32_t reqBytes; /* Request size, echoed back for in-flight accounting */
+};
+
+#define RPC_MAX_PAYLOAD (MAX_MTEXT - sizeof(struct rpc_hdr))
+
+/* Returns the reply length, *status goes back to the client */
+typedef ssize_t (*rpc_handler)(int op, const void *req, size_t reqLen,
+                               void *reply, size_t maxReply, int *status, void *arg);
+
+struct rpc_stash { /* Reply received by rpcSend(), not yet collected */
+    struct rpc_stash *next;
+    size_t len;
+    char mtext[];
+};
+
+struct rpc_budget { /* One per queue, in msg_rpc.c */
+    int msqid;
+    int users; /* Clients using it, 0 = free */
+    size_t bytes; /* Unanswered request bytes of all of them */
+    size_t max; /* Half of msg_qbytes */
+};
+
+struct rpc_client {
+    int msqid;
+    long replyType;
+    uint32_t nextId;
+    long inFlight; /* Sent but not yet collected, stashed ones included */
+    struct rpc_stash *stashHead, *stashTail;
+    long stashed;
+    size_t reqBytes; /* Our unanswered request bytes, part of budget->bytes */
+    struct rpc_budget *budget; /* Shared by this process's clients of msqid */
+};
+
+struct rpc_server {
+    int msqid;
+    int nthreads;
+    rpc_handler handler;
+    void *arg;
+    pthread_t threads[RPC_MAX_THREADS];
+};
+
+int rpcClientInit(struct rpc_client *c, int msqid);
+void rpcClientFree(struct rpc_client *c); /* Drops stashed replies, must be called */
+int rpcSend(struct rpc_client *c, int op, const void *data, size_t len, uint32_t *corrId);
+ssize_t rpcCollect(struct rpc_client *c, uint32_t *corrId, int *status,
+                   void *data, size_t maxLen, int msgflg);
+ssize_t rpcCall(struct rpc_client *c, int op, const void *req, size_t reqLen,
+                void *reply, size_t maxReply, int *status);
+
+int rpcServe(struct rpc_server *s, int msqid, int nthreads, rpc_handler handler, void *arg);
+int rpcStop(struct rpc_server *s);
+
+#endif
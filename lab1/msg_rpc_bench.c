@@ -0,0 +1,178 @@
+/*
+ * Compile: gcc -O2 -o msg_rpc_bench msg_rpc_bench.c msg_rpc.c -lpthread
+ * Run: ./msg_rpc_bench [calls] [server-threads] [service-usec]
+ *
+ * A server process answers echo requests from a thread pool; each request
+ * costs service-usec of CPU. The client keeps 1, 2, 4, ... 64 requests in
+ * flight and reports round trips per second for each pipelining depth.
+ * A second pass repeats the deepest pipeline with 900-byte payloads, where
+ * the replies alone outgrow msg_qbytes and rpcSend() has to make room.
+ * The last one splits the calls over CLIENTS threads, each with its own
+ * rpc_client and that deep pipeline, sharing the queue's request budget.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/msg.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "msg_rpc.h"
+
+#define OP_ECHO 1
+#define CLIENTS 4
+
+static long serviceNs;
+
+static long long nowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static ssize_t echoHandler(int op, const void *req, size_t reqLen,
+                           void *reply, size_t maxReply, int *status, void *arg)
+{
+    long long until = nowNs() + serviceNs;
+
+    while (nowNs() < until) { /* Simulated request processing */
+        continue;
+    }
+
+    memcpy(reply, req, reqLen);
+    *status = (op == OP_ECHO) ? 0 : -1;
+    return reqLen;
+}
+
+struct client_arg {
+    int msqid;
+    long calls;
+};
+
+static void pump(struct rpc_client *client, long calls, int depth, char *buf, size_t len)
+{
+    long sent, done;
+    int status;
+
+    for (sent = 0, done = 0; done < calls; done++) {
+        while (sent < calls && client->inFlight < depth) {
+            if (rpcSend(client, OP_ECHO, buf, len, NULL) == -1) {
+                perror("rpcSend");
+                exit(EXIT_FAILURE);
+            }
+
+            sent++;
+        }
+
+        if (rpcCollect(client, NULL, &status, buf, len, 0) != (ssize_t) len || status != 0) {
+            perror("rpcCollect");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+static void run(struct rpc_client *client, long calls, int depth, char *buf, size_t len)
+{
+    long long start = nowNs();
+
+    pump(client, calls, depth, buf, len);
+    printf("%7zu %5d %11.0f\n", len, depth, calls / ((nowNs() - start) / 1e9));
+}
+
+static void *clientThread(void *arg)
+{
+    struct client_arg *a = arg;
+    struct rpc_client client;
+    char buf[900];
+
+    if (rpcClientInit(&client, a->msqid) == -1) {
+        perror("rpcClientInit");
+        exit(EXIT_FAILURE);
+    }
+
+    memset(buf, 'x', sizeof(buf));
+    pump(&client, a->calls, 64, buf, sizeof(buf));
+    rpcClientFree(&client);
+    return NULL;
+}
+
+static void runClients(int msqid, long calls)
+{
+    struct client_arg a = { msqid, calls / CLIENTS };
+    pthread_t tids[CLIENTS];
+    long long start = nowNs();
+
+    for (int j = 0; j < CLIENTS; j++) {
+        if (pthread_create(&tids[j], NULL, clientThread, &a) != 0) {
+            fprintf(stderr, "pthread_create error");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    for (int j = 0; j < CLIENTS; j++) {
+        pthread_join(tids[j], NULL);
+    }
+
+    printf("%7d %2dx%2d %11.0f\n", 900, CLIENTS, 64, a.calls * CLIENTS / ((nowNs() - start) / 1e9));
+}
+
+int main(int argc, char *argv[])
+{
+    long calls = (argc > 1) ? atol(argv[1]) : 100000;
+    int threads = (argc > 2) ? atoi(argv[2]) : 4;
+    struct rpc_client client;
+    struct rpc_server server;
+    char buf[900];
+    int msqid, depth;
+    pid_t child;
+
+    serviceNs = ((argc > 3) ? atol(argv[3]) : 20) * 1000L;
+    msqid = msgget(IPC_PRIVATE, IPC_CREAT | S_IRUSR | S_IWUSR);
+
+    if (msqid == -1) {
+        perror("msgget");
+        exit(EXIT_FAILURE);
+    }
+
+    switch (child = fork()) {
+    case -1:
+        fprintf(stderr, "fork error");
+        msgctl(msqid, IPC_RMID, NULL);
+        exit(EXIT_FAILURE);
+
+    case 0: /* Server: runs until the queue is removed */
+        if (rpcServe(&server, msqid, threads, echoHandler, NULL) == -1) {
+            perror("rpcServe");
+            _exit(EXIT_FAILURE);
+        }
+
+        pause();
+        _exit(EXIT_SUCCESS);
+    }
+
+    if (rpcClientInit(&client, msqid) == -1) {
+        perror("rpcClientInit");
+        exit(EXIT_FAILURE);
+    }
+
+    memset(buf, 'x', sizeof(buf));
+    printf("calls=%ld server-threads=%d service=%ld us\n", calls, threads, serviceNs / 1000);
+    printf("payload depth   calls/sec\n");
+
+    for (depth = 1; depth <= 64; depth *= 2) {
+        run(&client, calls, depth, buf, 64);
+    }
+
+    run(&client, calls, 64, buf, sizeof(buf));
+    rpcClientFree(&client);
+    runClients(msqid, calls);
+    msgctl(msqid, IPC_RMID, NULL);
+    kill(child, SIGTERM);
+    waitpid(child, NULL, 0);
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,207 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/msg.h>
+#include <sys/stat.h>
+#include "msg_shard.h"
+
+static uint32_t hash32(const void *data, size_t len) /* FNV-1a with a final mix */
+{
+    const unsigned char *p = data;
+    uint32_t h = 2166136261u;
+
+    for (size_t j = 0; j < len; j++) {
+        h = (h ^ p[j]) * 16777619u;
+    }
+
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+
+    return h;
+}
+
+static int cmpPoint(const void *a, const void *b)
+{
+    const struct shard_point *x = a, *y = b;
+
+    if (x->hash != y->hash) {
+        return (x->hash > y->hash) - (x->hash < y->hash);
+    }
+
+    return x->shard - y->shard;
+}
+
+static __thread unsigned nextOwned, nextSteal; /* Round-robin start of scan() */
+
+/* Queue j is msgget(baseKey + j); IPC_PRIVATE creates K private queues */
+int shardCreate(struct shard_group *g, key_t baseKey, int nshards)
+{
+    int j, v, savedErrno, n = 0;
+    char created[SHARD_MAX];
+    uint32_t id[2];
+
+    if (nshards < 1 || nshards > SHARD_MAX) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (j = 0; j < nshards; j++) {
+        key_t key = (baseKey == IPC_PRIVATE) ? IPC_PRIVATE : baseKey + j;
+
+        /* Know which queues are ours, a failure removes only those */
+        g->msqids[j] = msgget(key, IPC_CREAT | IPC_EXCL | S_IRUSR | S_IWUSR);
+        created[j] = (g->msqids[j] != -1);
+
+        if (g->msqids[j] == -1 && errno == EEXIST) {
+            g->msqids[j] = msgget(key, S_IRUSR | S_IWUSR);
+        }
+
+        if (g->msqids[j] == -1) {
+            savedErrno = errno;
+
+            while (--j >= 0) {
+                if (created[j]) {
+                    msgctl(g->msqids[j], IPC_RMID, NULL);
+                }
+            }
+
+            errno = savedErrno;
+            return -1;
+        }
+
+        for (v = 0; v < SHARD_VNODES; v++) {
+            id[0] = j;
+            id[1] = v;
+            g->ring[n].hash = hash32(id, sizeof(id));
+            g->ring[n].shard = j;
+            n++;
+        }
+    }
+
+    g->nshards = nshards;
+    qsort(g->ring, n, sizeof(g->ring[0]), cmpPoint);
+
+    return 0;
+}
+
+int shardRemove(struct shard_group *g)
+{
+    int j, status = 0;
+
+    for (j = 0; j < g->nshards; j++) {
+        if (msgctl(g->msqids[j], IPC_RMID, NULL) == -1) {
+            status = -1;
+        }
+    }
+
+    return status;
+}
+
+/* First ring point clockwise from the key's hash */
+int shardFor(const struct shard_group *g, const void *key, size_t keyLen)
+{
+    uint32_t h = hash32(key, keyLen);
+    int lo = 0, hi = g->nshards * SHARD_VNODES, mid;
+
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+
+        if (g->ring[mid].hash < h) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return g->ring[lo == g->nshards * SHARD_VNODES ? 0 : lo].shard;
+}
+
+int shardSend(const struct shard_group *g, const void *key, size_t keyLen,
+              const struct mbuf *msg, size_t len, int msgflg)
+{
+    return msgsnd(g->msqids[shardFor(g, key, keyLen)], msg, len, msgflg);
+}
+
+/* One non-blocking pass: owned shards first, then the others if 'steal'.
+   Each pass starts one past where this thread last found a message, so a
+   busy shard cannot starve the rest. */
+static ssize_t scan(const struct shard_group *g, const int *owned, int nowned, int steal,
+                    struct mbuf *msg, size_t maxBytes, int msgflg, int *shard)
+{
+    ssize_t n;
+    int j, k, s, isOwned;
+
+    for (k = 0; k < nowned; k++) {
+        j = (nextOwned + k) % nowned;
+        n = msgrcv(g->msqids[owned[j]], msg, maxBytes, 0, msgflg | IPC_NOWAIT);
+
+        if (n != -1 || errno != ENOMSG) {
+            nextOwned = j + 1;
+            *shard = owned[j];
+            return n;
+        }
+    }
+
+    for (k = 0; steal && k < g->nshards; k++) {
+        s = (nextSteal + k) % g->nshards;
+
+        for (j = 0, isOwned = 0; j < nowned; j++) {
+            isOwned |= (owned[j] == s);
+        }
+
+        if (isOwned) {
+            continue;
+        }
+
+        n = msgrcv(g->msqids[s], msg, maxBytes, 0, msgflg | IPC_NOWAIT);
+
+        if (n != -1 || errno != ENOMSG) {
+            nextSteal = s + 1;
+            *shard = s;
+            return n;
+        }
+    }
+
+    errno = ENOMSG;
+    return -1;
+}
+
+/* Receives from the owned shards round-robin. With 'steal' set, other
+   shards are tried too (also round-robin) once every owned shard is empty. If nothing is pending anywhere
+   and IPC_NOWAIT is not given, waits: msgrcv() can only block on one queue,
+   so a single owned shard without stealing blocks there, anything else
+   rescans every shard after a pause that grows from SHARD_POLL_MIN_NS to
+   SHARD_POLL_MAX_NS while idle. A signal ends the wait with EINTR. */
+ssize_t shardRecv(const struct shard_group *g, const int *owned, int nowned, int steal,
+                  struct mbuf *msg, size_t maxBytes, int msgflg, int *shard)
+{
+    struct timespec idle = { 0, SHARD_POLL_MIN_NS };
+    ssize_t n;
+
+    if (nowned < 1) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (nowned == 1 && !steal && !(msgflg & IPC_NOWAIT)) {
+        *shard = owned[0];
+        return msgrcv(g->msqids[owned[0]], msg, maxBytes, 0, msgflg);
+    }
+
+    for (;;) {
+        n = scan(g, owned, nowned, steal, msg, maxBytes, msgflg, shard);
+
+        if (n != -1 || errno != ENOMSG || (msgflg & IPC_NOWAIT)) {
+            return n;
+        }
+
+        if (nanosleep(&idle, NULL) == -1) {
+            return -1; /* EINTR */
+        }
+
+        idle.tv_nsec = (idle.tv_nsec * 2 > SHARD_POLL_MAX_NS) ? SHARD_POLL_MAX_NS
+                        : idle.tv_nsec * 2;
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef MSG_SHARD_H
+#define MSG_SHARD_H /* Prevent accidental double inclusion */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "message_queue.h"
+
+/* A group of K System V queues used as one logical queue, so producers
+   contend on K kernel locks instead of one. Routing keys are placed on a
+   consistent-hash ring with SHARD_VNODES points per shard; growing the group
+   from K to K+1 shards moves only about 1/(K+1) of the keys. The ring only
+   depends on K, so every process computes the same mapping. */
+#define SHARD_MAX 64
+#define SHARD_VNODES 64
+#define SHARD_POLL_MIN_NS 20000L /* Idle rescan interval of shardRecv(), doubling ... */
+#define SHARD_POLL_MAX_NS 2000000L /* ... up to this */
+
+struct shard_point {
+    uint32_t hash;
+    int shard;
+};
+
+struct shard_group {
+    int nshards;
+    int msqids[SHARD_MAX];
+    struct shard_point ring[SHARD_MAX * SHARD_VNODES]; /* Sorted by hash */
+};
+
+int shardCreate(struct shard_group *g, key_t baseKey, int nshards);
+int shardRemove(struct shard_group *g);
+int shardFor(const struct shard_group *g, const void *key, size_t keyLen);
+int shardSend(const struct shard_group *g, const void *key, size_t keyLen,
+              const struct mbuf *msg, size_t len, int msgflg);
+ssize_t shardRecv(const struct shard_group *g, const int *owned, int nowned, int steal,
+                  struct mbuf *msg, size_t maxBytes, int msgflg, int *shard);
+
+#endif
@@ -0,0 +1,315 @@
+/*
+ * Compile: gcc -O2 -o msg_shard_bench msg_shard_bench.c msg_shard.c
+ * Run: ./msg_shard_bench [messages-per-producer] [max-producers]
+ *
+ * For 1, 2, 4, ... max-producers producer processes, sends with random
+ * routing keys into one queue and into a group with one shard per producer,
+ * one consumer per shard, and reports aggregate send throughput.
+ *
+ * A second table keeps one shard per producer but gives each of 2 consumers
+ * half of the shards, then adds stealing, then leaves a single consumer
+ * owning shard 0 and stealing the rest. Throughput there is end to end,
+ * until every message has been received. Once the consumers have gone idle
+ * one more message is put on every shard; a consumer that waits on only one
+ * of its shards misses these and the run shows up as "stalled".
+ *
+ * It also shows how many keys move when a group grows by one shard.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/msg.h>
+#include <sys/wait.h>
+#include "msg_shard.h"
+
+#define DATA_TYPE 1
+#define STOP_TYPE 2
+#define PAYLOAD 64
+#define STALL_SEC 10 /* No progress for this long: a shard is not served */
+
+struct bench_shared {
+    int go;
+    long received;
+};
+
+static double nowSec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void consumer(struct shard_group *g, int shard)
+{
+    struct mbuf msg;
+    int from;
+
+    for (;;) {
+        if (shardRecv(g, &shard, 1, 0, &msg, MAX_MTEXT, 0, &from) == -1) {
+            perror("shardRecv");
+            _exit(EXIT_FAILURE);
+        }
+
+        if (msg.mtype == STOP_TYPE) {
+            _exit(EXIT_SUCCESS);
+        }
+    }
+}
+
+static void ownerConsumer(struct shard_group *g, const int *owned, int nowned, int steal,
+                          long *received)
+{
+    struct mbuf msg;
+    int from;
+
+    for (;;) { /* Killed by the parent once everything arrived */
+        if (shardRecv(g, owned, nowned, steal, &msg, MAX_MTEXT, 0, &from) == -1) {
+            perror("shardRecv");
+            _exit(EXIT_FAILURE);
+        }
+
+        __atomic_add_fetch(received, 1, __ATOMIC_RELAXED);
+    }
+}
+
+static void producer(struct shard_group *g, volatile int *go, long messages, unsigned seed)
+{
+    struct mbuf msg;
+    unsigned key;
+
+    msg.mtype = DATA_TYPE;
+    memset(msg.mtext, 'x', PAYLOAD);
+
+    while (!*go) {
+        sched_yield();
+    }
+
+    for (long j = 0; j < messages; j++) {
+        key = rand_r(&seed);
+
+        if (shardSend(g, &key, sizeof(key), &msg, PAYLOAD, 0) == -1) {
+            perror("shardSend");
+            _exit(EXIT_FAILURE);
+        }
+    }
+
+    _exit(EXIT_SUCCESS);
+}
+
+static double run(int producers, int nshards, long messages, volatile int *go)
+{
+    struct shard_group g;
+    struct mbuf stop;
+    double start, secs;
+    pid_t pids[SHARD_MAX];
+    int j;
+
+    if (shardCreate(&g, IPC_PRIVATE, nshards) == -1) {
+        perror("shardCreate");
+        exit(EXIT_FAILURE);
+    }
+
+    *go = 0;
+
+    for (j = 0; j < nshards; j++) {
+        if (fork() == 0) {
+            consumer(&g, j);
+        }
+    }
+
+    for (j = 0; j < producers; j++) {
+        if ((pids[j] = fork()) == 0) {
+            producer(&g, go, messages, j + 1);
+        }
+    }
+
+    start = nowSec();
+    *go = 1;
+
+    for (j = 0; j < producers; j++) {
+        waitpid(pids[j], NULL, 0);
+    }
+
+    secs = nowSec() - start;
+    stop.mtype = STOP_TYPE;
+
+    for (j = 0; j < nshards; j++) { /* Behind all data on each shard */
+        msgsnd(g.msqids[j], &stop, 0, 0);
+    }
+
+    while (wait(NULL) > 0) {
+        continue;
+    }
+
+    shardRemove(&g);
+    return producers * messages / secs;
+}
+
+static long waitReceived(struct bench_shared *sh, long total) /* Or until progress stops */
+{
+    double last = nowSec();
+    long seen = 0;
+
+    while (seen < total && nowSec() - last < STALL_SEC) {
+        long now = __atomic_load_n(&sh->received, __ATOMIC_RELAXED);
+
+        if (now != seen) {
+            seen = now;
+            last = nowSec();
+        }
+
+        usleep(1000);
+    }
+
+    return seen;
+}
+
+/* 'consumers' consumers, consumer c owns the shards j with j % consumers == c */
+static double runOwned(int producers, int consumers, int steal, long messages,
+                       struct bench_shared *sh)
+{
+    struct shard_group g;
+    struct mbuf late;
+    double start, secs;
+    pid_t pids[SHARD_MAX], cons[SHARD_MAX];
+    long total = producers * messages, seen = 0;
+    int owned[SHARD_MAX], nowned, j, k;
+
+    if (shardCreate(&g, IPC_PRIVATE, producers) == -1) {
+        perror("shardCreate");
+        exit(EXIT_FAILURE);
+    }
+
+    sh->go = 0;
+    sh->received = 0;
+
+    for (j = 0; j < consumers; j++) {
+        for (k = j, nowned = 0; k < producers; k += consumers) {
+            owned[nowned++] = k;
+        }
+
+        if ((cons[j] = fork()) == -1) {
+            perror("fork");
+            exit(EXIT_FAILURE);
+        }
+
+        if (cons[j] == 0) {
+            ownerConsumer(&g, owned, nowned, steal, &sh->received);
+        }
+    }
+
+    for (j = 0; j < producers; j++) {
+        if ((pids[j] = fork()) == -1) {
+            perror("fork");
+            exit(EXIT_FAILURE);
+        }
+
+        if (pids[j] == 0) {
+            producer(&g, &sh->go, messages, j + 1);
+        }
+    }
+
+    start = nowSec();
+    sh->go = 1;
+
+    for (j = 0; j < producers; j++) {
+        waitpid(pids[j], NULL, 0);
+    }
+
+    waitReceived(sh, total);
+    secs = nowSec() - start;
+
+    /* Late messages, one per shard, while every consumer is idle */
+    usleep(50000);
+    late.mtype = DATA_TYPE;
+
+    for (j = 0; j < producers; j++) {
+        msgsnd(g.msqids[j], &late, 0, 0);
+    }
+
+    total += producers;
+    seen = waitReceived(sh, total);
+
+    for (j = 0; j < consumers; j++) {
+        kill(cons[j], SIGTERM);
+        waitpid(cons[j], NULL, 0);
+    }
+
+    shardRemove(&g);
+    return (seen < total) ? -1 : total / secs;
+}
+
+static void printRate(double rate)
+{
+    if (rate < 0) {
+        printf(" %15s", "stalled");
+    } else {
+        printf(" %15.0f", rate);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    long messages = (argc > 1) ? atol(argv[1]) : 50000;
+    int maxProducers = (argc > 2) ? atoi(argv[2]) : 32;
+    static struct shard_group a, b;
+    struct bench_shared *sh;
+    long moved = 0;
+    int p;
+
+    if (messages <= 0 || maxProducers < 1 || maxProducers > SHARD_MAX) {
+        fprintf(stderr, "Usage: %s [messages-per-producer] [max-producers <= %d]\n",
+                argv[0], SHARD_MAX);
+        exit(EXIT_FAILURE);
+    }
+
+    sh = mmap(NULL, sizeof(*sh), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    if (sh == MAP_FAILED) {
+        perror("mmap");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("producers  1-queue msgs/s  sharded msgs/s  speedup\n");
+
+    for (p = 1; p <= maxProducers; p *= 2) {
+        double one = run(p, 1, messages, &sh->go);
+        double sharded = run(p, p, messages, &sh->go);
+
+        printf("%9d %15.0f %15.0f %8.2fx\n", p, one, sharded, sharded / one);
+    }
+
+    printf("\nend to end msgs/s, shards = producers\n");
+    printf("producers  2 own half       + steal  1 own 0 + steal\n");
+
+    for (p = 2; p <= maxProducers; p *= 2) {
+        printf("%9d", p);
+        printRate(runOwned(p, 2, 0, messages, sh));
+        printRate(runOwned(p, 2, 1, messages, sh));
+        printRate(runOwned(p, 1, 1, messages, sh));
+        printf("\n");
+        fflush(stdout);
+    }
+
+    /* Consistent hashing check: 8 -> 9 shards should move about 1/9 of keys */
+    if (shardCreate(&a, IPC_PRIVATE, 8) == -1 || shardCreate(&b, IPC_PRIVATE, 9) == -1) {
+        perror("shardCreate");
+        exit(EXIT_FAILURE);
+    }
+
+    for (unsigned key = 0; key < 100000; key++) {
+        moved += shardFor(&a, &key, sizeof(key)) != shardFor(&b, &key, sizeof(key));
+    }
+
+    printf("8 -> 9 shards: %.1f%% of keys moved (ideal %.1f%%)\n", moved / 1000.0, 100.0 / 9);
+    shardRemove(&a);
+    shardRemove(&b);
+    exit(EXIT_SUCCESS);
+}
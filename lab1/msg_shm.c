@@ -0,0 +1,276 @@
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <sys/msg.h>
+#include <sys/shm.h>
+#include <sys/stat.h>
+#include "msg_shm.h"
+
+#define ARENA_MAGIC 0x41524e41 /* "ARNA" */
+
+static size_t arenaDataOffset(uint32_t nslots)
+{
+    size_t off = sizeof(struct arena_hdr) + nslots * sizeof(uint32_t);
+
+    return (off + 63) & ~(size_t) 63; /* Keep payloads cache-line aligned */
+}
+
+static void arenaLock(struct arena_hdr *h)
+{
+    while (__atomic_exchange_n(&h->lock, 1, __ATOMIC_ACQUIRE)) {
+        sched_yield();
+    }
+}
+
+static void arenaUnlock(struct arena_hdr *h)
+{
+    __atomic_store_n(&h->lock, 0, __ATOMIC_RELEASE);
+}
+
+static void arenaMap(struct shm_arena *a, int shmid, void *addr)
+{
+    a->shmid = shmid;
+    a->hdr = addr;
+    a->runLen = (uint32_t *) (a->hdr + 1);
+    a->data = (char *) addr + arenaDataOffset(a->hdr->nslots);
+}
+
+int arenaCreate(struct shm_arena *a, key_t key, size_t size, size_t slotSize)
+{
+    uint32_t nslots;
+    size_t total;
+    void *addr;
+    int shmid;
+
+    if (slotSize == 0 || size < slotSize) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    nslots = size / slotSize;
+    total = arenaDataOffset(nslots) + (size_t) nslots * slotSize;
+    shmid = shmget(key, total, IPC_CREAT | IPC_EXCL | S_IRUSR | S_IWUSR);
+
+    if (shmid == -1) {
+        return -1;
+    }
+
+    addr = shmat(shmid, NULL, 0);
+
+    if (addr == (void *) -1) {
+        shmctl(shmid, IPC_RMID, NULL);
+        return -1;
+    }
+
+    /* A fresh segment is zero-filled, so every runLen[] entry is already free */
+    ((struct arena_hdr *) addr)->nslots = nslots;
+    ((struct arena_hdr *) addr)->slotSize = slotSize;
+    arenaMap(a, shmid, addr);
+    __atomic_store_n(&a->hdr->magic, ARENA_MAGIC, __ATOMIC_RELEASE);
+
+    return 0;
+}
+
+int arenaAttach(struct shm_arena *a, int shmid)
+{
+    void *addr = shmat(shmid, NULL, 0);
+
+    if (addr == (void *) -1) {
+        return -1;
+    }
+
+    if (__atomic_load_n(&((struct arena_hdr *) addr)->magic, __ATOMIC_ACQUIRE) != ARENA_MAGIC) {
+        shmdt(addr);
+        errno = EINVAL;
+        return -1;
+    }
+
+    arenaMap(a, shmid, addr);
+    return 0;
+}
+
+int arenaDetach(struct shm_arena *a)
+{
+    return shmdt(a->hdr);
+}
+
+/* First-fit search for 'want' free slots in a row, starting at the hint */
+static int arenaAlloc(struct shm_arena *a, uint32_t want, uint32_t *slot)
+{
+    struct arena_hdr *h = a->hdr;
+    uint32_t start, j, run, pass;
+
+    arenaLock(h);
+
+    for (pass = 0; pass < 2; pass++) {
+        start = (pass == 0) ? h->hint : 0;
+
+        for (j = start, run = 0; j < h->nslots; ) {
+            if (a->runLen[j] != 0) { /* Skip over an allocated run */
+                j += a->runLen[j];
+                start = j;
+                run = 0;
+                continue;
+            }
+
+            if (++run == want) {
+                a->runLen[start] = want;
+
+                /* Interior slots of the run are marked so scans can skip them */
+                for (j = start + 1; j < start + want; j++) {
+                    a->runLen[j] = start + want - j;
+                }
+
+                h->hint = start + want;
+                arenaUnlock(h);
+                *slot = start;
+                return 0;
+            }
+
+            j++;
+        }
+    }
+
+    arenaUnlock(h);
+    errno = EAGAIN; /* Arena full for now, receivers will free slots */
+    return -1;
+}
+
+static void arenaFree(struct shm_arena *a, uint32_t slot)
+{
+    uint32_t n, j;
+
+    arenaLock(a->hdr);
+    n = a->runLen[slot];
+
+    for (j = slot; j < slot + n; j++) {
+        a->runLen[j] = 0;
+    }
+
+    if (slot < a->hdr->hint) {
+        a->hdr->hint = slot;
+    }
+
+    arenaUnlock(a->hdr);
+}
+
+/* Slots the run starting at 'slot' covers, 0 if no run starts there. An
+   interior slot holds the slots left to the end of its run, so 'slot'
+   continues the run before it exactly when that one's entry is 2 or more. */
+static uint32_t arenaRunAt(struct shm_arena *a, uint32_t slot)
+{
+    uint32_t n;
+
+    arenaLock(a->hdr);
+    n = a->runLen[slot];
+
+    if (slot > 0 && a->runLen[slot - 1] > 1) {
+        n = 0;
+    }
+
+    arenaUnlock(a->hdr);
+    return n;
+}
+
+int hybridSend(int msqid, struct shm_arena *a, long mtype,
+               const void *data, size_t len, size_t threshold)
+{
+    struct mbuf msg;
+    struct shm_desc d;
+    uint32_t want, slot;
+
+    msg.mtype = mtype;
+
+    if (len <= threshold && len <= HYB_MAX_INLINE) {
+        msg.mtext[0] = HYB_INLINE;
+        memcpy(msg.mtext + 1, data, len);
+        return msgsnd(msqid, &msg, len + 1, 0);
+    }
+
+    if (a == NULL) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    want = (len + a->hdr->slotSize - 1) / a->hdr->slotSize;
+
+    if (want == 0 || want > a->hdr->nslots) {
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    if (arenaAlloc(a, want, &slot) == -1) {
+        return -1;
+    }
+
+    memcpy(a->data + (size_t) slot * a->hdr->slotSize, data, len); /* The only copy */
+
+    d.shmid = a->shmid;
+    d.slot = slot;
+    d.length = len;
+    msg.mtext[0] = HYB_SHM;
+    memcpy(msg.mtext + 1, &d, sizeof(d));
+
+    if (msgsnd(msqid, &msg, 1 + sizeof(d), 0) == -1) {
+        int savedErrno = errno;
+
+        arenaFree(a, slot);
+        errno = savedErrno;
+        return -1;
+    }
+
+    return 0;
+}
+
+int hybridRecv(int msqid, struct shm_arena *a, long mtype,
+               struct hybrid_msg *m, int msgflg)
+{
+    ssize_t msgLen = msgrcv(msqid, &m->msg, MAX_MTEXT, mtype, msgflg);
+    struct shm_desc d;
+
+    if (msgLen == -1) {
+        return -1;
+    }
+
+    m->inArena = 0;
+
+    if (msgLen >= 1 && m->msg.mtext[0] == HYB_INLINE) {
+        m->data = m->msg.mtext + 1;
+        m->len = msgLen - 1;
+        return 0;
+    }
+
+    if (msgLen != 1 + sizeof(d) || m->msg.mtext[0] != HYB_SHM) {
+        errno = EBADMSG;
+        return -1;
+    }
+
+    memcpy(&d, m->msg.mtext + 1, sizeof(d));
+
+    if (a == NULL || d.shmid != a->shmid || d.slot >= a->hdr->nslots) {
+        errno = EINVAL; /* Descriptor for an arena we are not attached to */
+        return -1;
+    }
+
+    /* A stale or corrupt descriptor must not read past its run or free
+       someone else's slots */
+    if (d.length > (uint64_t) arenaRunAt(a, d.slot) * a->hdr->slotSize) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    m->data = a->data + (size_t) d.slot * a->hdr->slotSize;
+    m->len = d.length;
+    m->slot = d.slot;
+    m->inArena = 1;
+
+    return 0;
+}
+
+void hybridRelease(struct shm_arena *a, struct hybrid_msg *m)
+{
+    if (m->inArena) {
+        arenaFree(a, m->slot);
+        m->inArena = 0;
+    }
+}
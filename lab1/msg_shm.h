@@ -0,0 +1,58 @@
+#ifndef MSG_SHM_H
+#define MSG_SHM_H /* Prevent accidental double inclusion */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "message_queue.h"
+
+/* Hybrid transport: payloads up to a threshold travel inline in struct mbuf,
+   larger ones are written once into a shared memory arena and only a
+   descriptor goes through the queue. The receiver reads the payload in place
+   and hands the slots back with hybridRelease(). */
+
+#define HYB_INLINE 'I' /* mtext = [kind][payload] */
+#define HYB_SHM 'S' /* mtext = [kind][struct shm_desc] */
+#define HYB_MAX_INLINE (MAX_MTEXT - 1)
+
+struct shm_desc { /* What actually crosses the queue for a large payload */
+    int32_t shmid; /* Arena segment */
+    uint32_t slot; /* First slot of the run */
+    uint64_t length; /* Payload bytes */
+};
+
+struct arena_hdr { /* Start of the shared memory segment */
+    uint32_t magic;
+    uint32_t nslots;
+    uint64_t slotSize;
+    int lock; /* Spinlock guarding runLen[] */
+    uint32_t hint; /* Where the next first-fit search starts */
+    /* uint32_t runLen[nslots] follows: slots in the run starting here, 0 = free */
+};
+
+struct shm_arena { /* Per-process view of an arena */
+    int shmid;
+    struct arena_hdr *hdr;
+    uint32_t *runLen;
+    char *data;
+};
+
+struct hybrid_msg { /* One received message */
+    const char *data; /* Payload, inline or inside the arena */
+    size_t len;
+    int inArena; /* Must be passed to hybridRelease() */
+    uint32_t slot;
+    struct mbuf msg;
+};
+
+int arenaCreate(struct shm_arena *a, key_t key, size_t size, size_t slotSize);
+int arenaAttach(struct shm_arena *a, int shmid);
+int arenaDetach(struct shm_arena *a);
+
+int hybridSend(int msqid, struct shm_arena *a, long mtype,
+               const void *data, size_t len, size_t threshold);
+int hybridRecv(int msqid, struct shm_arena *a, long mtype,
+               struct hybrid_msg *m, int msgflg);
+void hybridRelease(struct shm_arena *a, struct hybrid_msg *m);
+
+#endif
@@ -0,0 +1,209 @@
+/*
+ * Compile: gcc -O2 -o msg_shm_bench msg_shm_bench.c msg_shm.c
+ * Run: ./msg_shm_bench [messages] [payload-bytes] [arena-mb]
+ *
+ * Moves large payloads from a producer to a consumer process twice:
+ * split into MAX_MTEXT pieces through the queue, and through the hybrid
+ * transport where only a descriptor is queued.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <sched.h>
+#include <sys/msg.h>
+#include <sys/shm.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "msg_shm.h"
+
+#define DATA_TYPE 1
+#define SLOT_SIZE (64 * 1024)
+
+static int msqid = -1;
+static struct shm_arena arena = { -1 };
+
+static void removeIpc(void) /* atexit(): error paths must not leak the arena */
+{
+    if (arena.shmid != -1) {
+        arenaDetach(&arena);
+        shmctl(arena.shmid, IPC_RMID, NULL);
+    }
+
+    if (msqid != -1) {
+        msgctl(msqid, IPC_RMID, NULL);
+    }
+}
+
+static pid_t spawn(void)
+{
+    pid_t child = fork();
+
+    if (child == -1) {
+        fprintf(stderr, "fork error");
+        exit(EXIT_FAILURE);
+    }
+
+    return child;
+}
+
+static void reap(pid_t child, const char *what) /* A failed consumer voids the run */
+{
+    int status;
+
+    if (waitpid(child, &status, 0) == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        fprintf(stderr, "%s consumer failed\n", what);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static double nowSec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned long checksum(const char *p, size_t len) /* Make the consumer read every byte */
+{
+    unsigned long sum = 0;
+
+    for (size_t j = 0; j < len; j += 64) {
+        sum += (unsigned char) p[j];
+    }
+
+    return sum;
+}
+
+static void consumeChunked(int msqid, long messages, size_t payload)
+{
+    struct mbuf msg;
+    unsigned long sum = 0;
+    size_t got;
+    ssize_t n;
+
+    for (long m = 0; m < messages; m++) {
+        for (got = 0; got < payload; got += n) {
+            n = msgrcv(msqid, &msg, MAX_MTEXT, DATA_TYPE, 0);
+
+            if (n == -1) {
+                perror("msgrcv");
+                _exit(EXIT_FAILURE);
+            }
+
+            sum += checksum(msg.mtext, n);
+        }
+    }
+
+    _exit(sum == 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+static void consumeHybrid(int msqid, int arenaId, long messages)
+{
+    struct shm_arena arena;
+    struct hybrid_msg m;
+    unsigned long sum = 0;
+
+    if (arenaAttach(&arena, arenaId) == -1) {
+        perror("arenaAttach");
+        _exit(EXIT_FAILURE);
+    }
+
+    for (long j = 0; j < messages; j++) {
+        if (hybridRecv(msqid, &arena, DATA_TYPE, &m, 0) == -1) {
+            perror("hybridRecv");
+            _exit(EXIT_FAILURE);
+        }
+
+        sum += checksum(m.data, m.len);
+        hybridRelease(&arena, &m);
+    }
+
+    _exit(sum == 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+int main(int argc, char *argv[])
+{
+    long messages = (argc > 1) ? atol(argv[1]) : 200;
+    size_t payload = (argc > 2) ? (size_t) atol(argv[2]) : 4 * 1024 * 1024;
+    size_t arenaSize = ((argc > 3) ? (size_t) atol(argv[3]) : 64) * 1024 * 1024;
+    struct mbuf msg;
+    char *data;
+    double start, chunked, hybrid;
+    size_t off, n;
+    pid_t child;
+
+    if (messages <= 0 || payload == 0 || payload > arenaSize) {
+        fprintf(stderr, "Usage: %s [messages] [payload-bytes] [arena-mb]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    data = malloc(payload);
+
+    if (data == NULL) {
+        fprintf(stderr, "malloc error");
+        exit(EXIT_FAILURE);
+    }
+
+    memset(data, 'x', payload);
+    atexit(removeIpc);
+    msqid = msgget(IPC_PRIVATE, IPC_CREAT | S_IRUSR | S_IWUSR);
+
+    if (msqid == -1 || arenaCreate(&arena, IPC_PRIVATE, arenaSize, SLOT_SIZE) == -1) {
+        perror("msgget/arenaCreate");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Path 1: payload split across ordinary messages, copied in and out of the kernel */
+    if ((child = spawn()) == 0) {
+        consumeChunked(msqid, messages, payload);
+    }
+
+    msg.mtype = DATA_TYPE;
+    start = nowSec();
+
+    for (long m = 0; m < messages; m++) {
+        for (off = 0; off < payload; off += n) {
+            n = (payload - off < MAX_MTEXT) ? payload - off : MAX_MTEXT;
+            memcpy(msg.mtext, data + off, n);
+
+            if (msgsnd(msqid, &msg, n, 0) == -1) {
+                perror("msgsnd");
+                exit(EXIT_FAILURE);
+            }
+        }
+    }
+
+    reap(child, "chunked");
+    chunked = nowSec() - start;
+
+    /* Path 2: payload written once into the arena, descriptor queued */
+    if ((child = spawn()) == 0) {
+        consumeHybrid(msqid, arena.shmid, messages);
+    }
+
+    start = nowSec();
+
+    for (long m = 0; m < messages; ) {
+        if (hybridSend(msqid, &arena, DATA_TYPE, data, payload, HYB_MAX_INLINE) == 0) {
+            m++;
+        } else if (errno == EAGAIN) {
+            sched_yield(); /* Arena full, wait for the consumer to release slots */
+        } else {
+            perror("hybridSend");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    reap(child, "hybrid");
+    hybrid = nowSec() - start;
+
+    printf("messages=%ld payload=%zu bytes\n", messages, payload);
+    printf("chunked msgsnd: %8.1f MB/s (%.3f s)\n", messages * payload / chunked / 1e6, chunked);
+    printf("hybrid shm:     %8.1f MB/s (%.3f s)\n", messages * payload / hybrid / 1e6, hybrid);
+    exit(EXIT_SUCCESS); /* removeIpc() cleans up */
+}
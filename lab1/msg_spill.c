@@ -0,0 +1,252 @@
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/msg.h>
+#include <sys/stat.h>
+#include "msg_spill.h"
+
+#define SPILL_MAGIC 0x4c4c5053 /* "SPLL" */
+#define WRAP_MARK UINT32_MAX /* Rest of the ring is unused, next record is at 0 */
+#define RETRY_NSEC 1000000L /* Drain retry interval while the queue is full */
+
+struct spill_rec { /* Record header, followed by len bytes of mtext */
+    uint32_t len;
+    uint32_t pad;
+    int64_t mtype;
+};
+
+static size_t recSize(size_t len) /* Keep records 8-byte aligned */
+{
+    return (sizeof(struct spill_rec) + len + 7) & ~(size_t) 7;
+}
+
+/* Caller holds s->lock */
+static int journalAppend(struct msg_spill *s, const struct mbuf *msg, size_t len)
+{
+    struct spill_hdr *h = s->hdr;
+    struct spill_rec *r;
+    size_t need = recSize(len), tailRoom;
+    uint64_t tail = h->tail, used = h->used;
+
+    tailRoom = h->capacity - tail;
+
+    if (used > 0 && tail <= h->head) { /* Free space is between tail and head */
+        tailRoom = h->head - tail;
+    }
+
+    if (need > tailRoom) {
+        /* Wrap: only possible when the free space at the start is big enough */
+        if (used > 0 && tail <= h->head) {
+            errno = EAGAIN;
+            return -1;
+        }
+
+        if ((used > 0 && need > h->head) || need > h->capacity) {
+            errno = EAGAIN; /* Journal full too: the one case we must refuse */
+            return -1;
+        }
+
+        if (tailRoom >= sizeof(uint32_t)) {
+            *(uint32_t *) (s->ring + tail) = WRAP_MARK;
+        }
+
+        used += tailRoom;
+        tail = 0;
+    }
+
+    r = (struct spill_rec *) (s->ring + tail);
+    r->len = len;
+    r->mtype = msg->mtype;
+    memcpy(r + 1, msg->mtext, len);
+
+    h->tail = (tail + need == h->capacity) ? 0 : tail + need;
+    h->used = used + need;
+
+    return 0;
+}
+
+/* Caller holds s->lock and the journal is not empty */
+static struct spill_rec *journalHead(struct msg_spill *s)
+{
+    struct spill_hdr *h = s->hdr;
+
+    if (h->capacity - h->head < sizeof(uint32_t) ||
+            *(uint32_t *) (s->ring + h->head) == WRAP_MARK) {
+        h->used -= h->capacity - h->head;
+        h->head = 0;
+    }
+
+    return (struct spill_rec *) (s->ring + h->head);
+}
+
+static void journalPop(struct msg_spill *s, struct spill_rec *r)
+{
+    struct spill_hdr *h = s->hdr;
+    size_t size = recSize(r->len);
+
+    h->head = (h->head + size == h->capacity) ? 0 : h->head + size;
+    h->used -= size;
+
+    if (h->used == 0) { /* Restart at the front so wrapping stays rare */
+        h->head = h->tail = 0;
+    }
+}
+
+static void *drainThread(void *arg)
+{
+    struct msg_spill *s = arg;
+    struct timespec retry = { 0, RETRY_NSEC };
+    struct spill_rec *r;
+    struct mbuf msg;
+
+    pthread_mutex_lock(&s->lock);
+
+    for (;;) {
+        while (s->hdr->used == 0 && !s->stop) {
+            pthread_cond_wait(&s->nonEmpty, &s->lock);
+        }
+
+        if (s->hdr->used == 0) { /* Stopped and fully drained */
+            break;
+        }
+
+        r = journalHead(s);
+        msg.mtype = r->mtype;
+        memcpy(msg.mtext, r + 1, r->len);
+
+        /* Non-blocking, so holding the lock here never stalls producers for long */
+        if (msgsnd(s->msqid, &msg, r->len, IPC_NOWAIT) == 0) {
+            journalPop(s, r);
+            s->reinjected++;
+            continue;
+        }
+
+        if (errno != EAGAIN && errno != EINTR) {
+            break; /* Queue removed; leave the records in the journal */
+        }
+
+        pthread_mutex_unlock(&s->lock);
+        nanosleep(&retry, NULL);
+        pthread_mutex_lock(&s->lock);
+    }
+
+    pthread_mutex_unlock(&s->lock);
+    return NULL;
+}
+
+/* Opens or creates the journal. Records left by an earlier run are drained first. */
+int spillOpen(struct msg_spill *s, int msqid, const char *path, size_t capacity)
+{
+    size_t mapSize = sizeof(struct spill_hdr) + capacity;
+    struct stat st;
+    void *addr;
+    int savedErrno;
+
+    memset(s, 0, sizeof(*s));
+    s->msqid = msqid;
+    s->fd = open(path, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+
+    if (s->fd == -1) {
+        return -1;
+    }
+
+    if (fstat(s->fd, &st) == -1) {
+        goto fail;
+    }
+
+    if (st.st_size >= (off_t) sizeof(struct spill_hdr)) { /* Existing journal keeps its size */
+        mapSize = st.st_size;
+    } else if (ftruncate(s->fd, mapSize) == -1) {
+        goto fail;
+    }
+
+    addr = mmap(NULL, mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, s->fd, 0);
+
+    if (addr == MAP_FAILED) {
+        goto fail;
+    }
+
+    s->hdr = addr;
+    s->ring = (char *) (s->hdr + 1);
+
+    if (s->hdr->magic != SPILL_MAGIC || s->hdr->capacity != mapSize - sizeof(struct spill_hdr)) {
+        memset(s->hdr, 0, sizeof(*s->hdr)); /* New or foreign file: start empty */
+        s->hdr->capacity = mapSize - sizeof(struct spill_hdr);
+        s->hdr->magic = SPILL_MAGIC;
+    }
+
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->nonEmpty, NULL);
+    errno = pthread_create(&s->drainer, NULL, drainThread, s);
+
+    if (errno != 0) {
+        munmap(addr, mapSize);
+        goto fail;
+    }
+
+    return 0;
+
+fail:
+    savedErrno = errno;
+    close(s->fd);
+    errno = savedErrno;
+    return -1;
+}
+
+int spillSend(struct msg_spill *s, const struct mbuf *msg, size_t len)
+{
+    int status = 0;
+
+    if (len > MAX_MTEXT) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    pthread_mutex_lock(&s->lock);
+
+    if (s->hdr->used == 0 && msgsnd(s->msqid, msg, len, IPC_NOWAIT) == 0) {
+        s->direct++;
+    } else if (s->hdr->used == 0 && errno != EAGAIN) {
+        status = -1; /* A real error, not a full queue */
+    } else if (journalAppend(s, msg, len) == -1) {
+        status = -1;
+    } else {
+        s->spilled++;
+        pthread_cond_signal(&s->nonEmpty);
+    }
+
+    pthread_mutex_unlock(&s->lock);
+    return status;
+}
+
+size_t spillPending(struct msg_spill *s) /* Journal bytes still waiting */
+{
+    size_t used;
+
+    pthread_mutex_lock(&s->lock);
+    used = s->hdr->used;
+    pthread_mutex_unlock(&s->lock);
+
+    return used;
+}
+
+/* Waits until the journal is drained, then stops the drain thread */
+int spillClose(struct msg_spill *s)
+{
+    size_t mapSize = sizeof(struct spill_hdr) + s->hdr->capacity;
+
+    pthread_mutex_lock(&s->lock);
+    s->stop = 1;
+    pthread_cond_signal(&s->nonEmpty);
+    pthread_mutex_unlock(&s->lock);
+    pthread_join(s->drainer, NULL);
+
+    pthread_mutex_destroy(&s->lock);
+    pthread_cond_destroy(&s->nonEmpty);
+    munmap(s->hdr, mapSize);
+
+    return close(s->fd);
+}
@@ -0,0 +1,42 @@
+#ifndef MSG_SPILL_H
+#define MSG_SPILL_H /* Prevent accidental double inclusion */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "message_queue.h"
+
+/* Overflow spill: when the queue is full, spillSend() appends the message to
+   a memory-mapped journal file instead of blocking. A drain thread moves
+   journal records back into the queue, oldest first, as room appears. While
+   the journal holds anything, new messages go behind it so order is kept. */
+
+struct spill_hdr { /* Start of the journal file */
+    uint32_t magic;
+    uint32_t reserved;
+    uint64_t capacity; /* Bytes in the record ring after this header */
+    uint64_t head; /* Offset of the oldest record */
+    uint64_t tail; /* Offset where the next record goes */
+    uint64_t used; /* Bytes held by records, 0 = empty */
+};
+
+struct msg_spill {
+    int msqid;
+    int fd;
+    struct spill_hdr *hdr;
+    char *ring;
+    pthread_mutex_t lock;
+    pthread_cond_t nonEmpty;
+    pthread_t drainer;
+    int stop;
+    long direct; /* Sent straight to the queue */
+    long spilled; /* Appended to the journal */
+    long reinjected; /* Moved from the journal to the queue */
+};
+
+int spillOpen(struct msg_spill *s, int msqid, const char *path, size_t capacity);
+int spillSend(struct msg_spill *s, const struct mbuf *msg, size_t len);
+size_t spillPending(struct msg_spill *s);
+int spillClose(struct msg_spill *s);
+
+#endif
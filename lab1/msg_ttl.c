@@ -0,0 +1,155 @@
+#define _GNU_SOURCE /* MSG_COPY */
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/msg.h>
+#include "msg_ttl.h"
+
+long long ttlNow(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* 1 = carries a header and is past its deadline */
+static int ttlExpired(const struct mbuf *msg, ssize_t len, long long now)
+{
+    struct ttl_hdr h;
+
+    if (len < (ssize_t) sizeof(h)) {
+        return 0;
+    }
+
+    memcpy(&h, msg->mtext, sizeof(h));
+    return h.magic == TTL_MAGIC && h.deadlineNs != 0 && h.deadlineNs < now;
+}
+
+/* Drops the header, if any, from a received message; returns the new length */
+static ssize_t stripHeader(struct mbuf *msg, ssize_t n)
+{
+    struct ttl_hdr h;
+
+    if (n >= (ssize_t) sizeof(h)) {
+        memcpy(&h, msg->mtext, sizeof(h));
+
+        if (h.magic == TTL_MAGIC) {
+            n -= sizeof(h);
+            memmove(msg->mtext, msg->mtext + sizeof(h), n);
+        }
+    }
+
+    return n;
+}
+
+int ttlSend(int msqid, long mtype, const void *data, size_t len, long ttlMs, int flags)
+{
+    struct mbuf msg;
+    struct ttl_hdr h;
+
+    if (len > TTL_MAX_PAYLOAD || ttlMs < 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    h.magic = TTL_MAGIC;
+    h.reserved = 0;
+    h.enqNs = ttlNow();
+    h.deadlineNs = (ttlMs > 0) ? h.enqNs + ttlMs * 1000000LL : 0;
+    msg.mtype = mtype;
+    memcpy(msg.mtext, &h, sizeof(h));
+    memcpy(msg.mtext + sizeof(h), data, len);
+
+    return queue_send(msqid, &msg, sizeof(h) + len, flags);
+}
+
+/* queue_receive() that never returns an expired message; the header is
+   stripped so msg->mtext holds only the payload */
+ssize_t ttlRecv(int msqid, struct mbuf *msg, size_t maxBytes, long type, int flags,
+                struct ttl_stats *st)
+{
+    ssize_t n;
+
+    for (;;) {
+        n = queue_receive(msqid, msg, MAX_MTEXT, type, flags | MSG_NOERROR);
+
+        if (n == -1) {
+            return -1;
+        }
+
+        if (!ttlExpired(msg, n, ttlNow())) {
+            break;
+        }
+
+        st->shed++; /* Expired: drop it and look at the next one */
+    }
+
+    n = stripHeader(msg, n);
+
+    if ((size_t) n > maxBytes) {
+        if (!(flags & MSG_NOERROR)) { /* Already dequeued, unlike plain msgrcv() */
+            errno = E2BIG;
+            return -1;
+        }
+
+        n = maxBytes;
+    }
+
+    st->delivered++;
+    return n;
+}
+
+/* Bulk purge of an expired backlog at the head of a System V queue. Peeks
+   with MSG_COPY (which leaves the queue alone) to find how many leading
+   messages have expired, then removes that many. A consumer may race us
+   for the head, so every message removed is checked again; the first live
+   one ends the sweep and is handed to the caller in 'live', header
+   stripped as by ttlRecv() (*liveLen is its length, -1 if there was none);
+   the caller now owns it like any consumer.
+   Nothing live is sent back or dropped. Returns the number of messages
+   dropped. */
+long ttlSweep(int msqid, long maxMessages, struct ttl_stats *st,
+              struct mbuf *live, ssize_t *liveLen)
+{
+    struct mbuf msg;
+    long long now = ttlNow();
+    long expired, j, dropped = 0;
+    ssize_t n;
+
+    *liveLen = -1;
+
+    for (expired = 0; expired < maxMessages; expired++) {
+        n = msgrcv(msqid, &msg, MAX_MTEXT, expired, MSG_COPY | IPC_NOWAIT);
+
+        if (n == -1) {
+            if (errno == ENOMSG) {
+                break;
+            }
+
+            return -1; /* ENOSYS: kernel without CONFIG_CHECKPOINT_RESTORE */
+        }
+
+        if (!ttlExpired(&msg, n, now)) {
+            break;
+        }
+    }
+
+    for (j = 0; j < expired; j++) {
+        n = msgrcv(msqid, live, MAX_MTEXT, 0, IPC_NOWAIT);
+
+        if (n == -1) {
+            break; /* Consumers emptied the queue first */
+        }
+
+        if (!ttlExpired(live, n, now)) {
+            *liveLen = stripHeader(live, n); /* Took a live one: the caller delivers it */
+            break;
+        }
+
+        dropped++;
+    }
+
+    st->swept += dropped;
+    return dropped;
+}
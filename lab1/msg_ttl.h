@@ -0,0 +1,36 @@
+#ifndef MSG_TTL_H
+#define MSG_TTL_H /* Prevent accidental double inclusion */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "message_queue.h"
+
+/* Optional header at the front of mtext. Messages that do not start with
+   TTL_MAGIC are passed through untouched, so plain senders keep working.
+   Times are CLOCK_MONOTONIC nanoseconds, deadlineNs 0 means no expiry. */
+#define TTL_MAGIC 0x314c5454 /* "TTL1" */
+
+struct ttl_hdr {
+    uint32_t magic;
+    uint32_t reserved;
+    int64_t enqNs; /* When the message was sent */
+    int64_t deadlineNs; /* Drop instead of deliver after this */
+};
+
+#define TTL_MAX_PAYLOAD (MAX_MTEXT - sizeof(struct ttl_hdr))
+
+struct ttl_stats {
+    long delivered; /* Returned to the caller */
+    long shed; /* Dropped by ttlRecv() because they had expired */
+    long swept; /* Dropped by ttlSweep() */
+};
+
+long long ttlNow(void);
+int ttlSend(int msqid, long mtype, const void *data, size_t len, long ttlMs, int flags);
+ssize_t ttlRecv(int msqid, struct mbuf *msg, size_t maxBytes, long type, int flags,
+                struct ttl_stats *st);
+long ttlSweep(int msqid, long maxMessages, struct ttl_stats *st,
+              struct mbuf *live, ssize_t *liveLen);
+
+#endif
@@ -0,0 +1,319 @@
+/*
+ * Compile: gcc -O2 -o msgbench msgbench.c
+ * Run: ./msgbench [-n messages] [-s sizes] [-p producers] [-c consumers]
+ *                 [-m block,nowait] [-t] > results.csv
+ *
+ * Sweeps payload size, producer/consumer counts and receive mode over a
+ * private queue, removed on exit, and prints one CSV row per combination.
+ * Every message carries its send time, so consumers measure send-to-receive
+ * latency. With -t each combination is also run with MSG_NOERROR
+ * truncation: the receive buffer is half the payload, but never less than
+ * the timestamp, so sizes below 16 bytes get no truncated run.
+ *
+ * Lists are comma separated, e.g. -s 8,64,512,1024 -p 1,4 -c 1,4
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/msg.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "message_queue.h"
+
+#define DATA_TYPE 1
+#define STOP_TYPE 2 /* Received with msgtyp -STOP_TYPE, so only after all data */
+#define MAX_LIST 16
+
+struct shared { /* Anonymous shared mapping seen by all benchmark processes */
+    volatile int go;
+    long next; /* Next free slot in lat[] */
+    long lat[]; /* Send-to-receive latency, ns */
+};
+
+static int benchQueue = -1;
+
+static void removeQueue(void)
+{
+    msgctl(benchQueue, IPC_RMID, NULL);
+}
+
+static long long nowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Returns the number of entries, -1 if one is not a number >= 1 */
+static int parseList(const char *arg, long *list)
+{
+    int n = 0;
+    char *end;
+
+    while (*arg != '\0' && n < MAX_LIST) {
+        list[n] = strtol(arg, &end, 10);
+
+        if (end == arg || list[n] < 1 || (*end != ',' && *end != '\0')) {
+            return -1;
+        }
+
+        n++;
+        arg = (*end == ',') ? end + 1 : end;
+    }
+
+    return n;
+}
+
+static pid_t spawn(void)
+{
+    pid_t pid = fork();
+
+    if (pid == -1) {
+        perror("fork");
+        exit(EXIT_FAILURE); /* Children already started die with the queue */
+    }
+
+    return pid;
+}
+
+static int cmpLong(const void *a, const void *b)
+{
+    long x = *(const long *) a, y = *(const long *) b;
+
+    return (x > y) - (x < y);
+}
+
+static void drainQueue(int msqid) /* Leftovers of a failed run, the queue is ours */
+{
+    struct mbuf msg;
+
+    while (msgrcv(msqid, &msg, MAX_MTEXT, 0, IPC_NOWAIT | MSG_NOERROR) != -1) {
+        continue;
+    }
+}
+
+static void producer(int msqid, struct shared *sh, long count, size_t size)
+{
+    struct mbuf msg;
+    long long ts;
+
+    memset(msg.mtext, 'x', size);
+    msg.mtype = DATA_TYPE;
+
+    while (!sh->go) {
+        sched_yield();
+    }
+
+    for (long j = 0; j < count; j++) {
+        ts = nowNs();
+        memcpy(msg.mtext, &ts, sizeof(ts));
+
+        if (msgsnd(msqid, &msg, size, 0) == -1) {
+            perror("msgsnd");
+            _exit(EXIT_FAILURE);
+        }
+    }
+
+    _exit(EXIT_SUCCESS);
+}
+
+static void consumer(int msqid, struct shared *sh, size_t maxBytes, int rcvflg)
+{
+    struct mbuf msg;
+    long long ts;
+    long slot;
+
+    for (;;) {
+        if (msgrcv(msqid, &msg, maxBytes, -STOP_TYPE, rcvflg) == -1) {
+            if (errno == ENOMSG) { /* IPC_NOWAIT mode: poll again */
+                sched_yield();
+                continue;
+            }
+
+            perror("msgrcv");
+            _exit(EXIT_FAILURE);
+        }
+
+        if (msg.mtype == STOP_TYPE) {
+            break;
+        }
+
+        memcpy(&ts, msg.mtext, sizeof(ts));
+        slot = __atomic_fetch_add(&sh->next, 1, __ATOMIC_RELAXED);
+        sh->lat[slot] = nowNs() - ts;
+    }
+
+    _exit(EXIT_SUCCESS);
+}
+
+static void runOne(int msqid, struct shared *sh, long messages, size_t size,
+                   int producers, int consumers, int nowait, int truncate)
+{
+    size_t maxBytes = truncate ? (size / 2 > sizeof(long long) ? size / 2 : sizeof(long long)) : size;
+    int rcvflg = (nowait ? IPC_NOWAIT : 0) | (truncate ? MSG_NOERROR : 0);
+    long perProducer = messages / producers, total = perProducer * producers;
+    struct mbuf stop;
+    long long start;
+    double secs;
+    int j, status;
+
+    drainQueue(msqid);
+    sh->go = 0;
+    sh->next = 0;
+
+    for (j = 0; j < consumers; j++) {
+        if (spawn() == 0) {
+            consumer(msqid, sh, maxBytes, rcvflg);
+        }
+    }
+
+    for (j = 0; j < producers; j++) {
+        if (spawn() == 0) {
+            producer(msqid, sh, perProducer, size);
+        }
+    }
+
+    start = nowNs();
+    sh->go = 1;
+
+    /* Producers finish first, then one stop message per consumer. A child
+       that fails never reports its messages, so watch for that too. */
+    while (__atomic_load_n(&sh->next, __ATOMIC_RELAXED) < total) {
+        pid_t pid = waitpid(-1, &status, WNOHANG);
+
+        if (pid > 0 && !(WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS)) {
+            fprintf(stderr, "child %ld failed, %ld of %ld messages received\n",
+                    (long) pid, __atomic_load_n(&sh->next, __ATOMIC_RELAXED), total);
+            exit(EXIT_FAILURE); /* The others die with the queue */
+        }
+
+        sched_yield();
+    }
+
+    secs = (nowNs() - start) / 1e9;
+    stop.mtype = STOP_TYPE;
+
+    for (j = 0; j < consumers; j++) {
+        if (msgsnd(msqid, &stop, 0, 0) == -1) {
+            perror("msgsnd stop");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    while (wait(NULL) > 0) {
+        continue;
+    }
+
+    qsort(sh->lat, total, sizeof(long), cmpLong);
+    printf("%zu,%d,%d,%s,%d,%ld,%.6f,%.0f,%.3f,%.2f,%.2f,%.2f\n",
+           size, producers, consumers, nowait ? "nowait" : "block", truncate,
+           total, secs, total / secs, total * (double) size / secs / 1e6,
+           sh->lat[total / 2] / 1e3,
+           sh->lat[(long) (total * 0.99)] / 1e3,
+           sh->lat[(long) (total * 0.999)] / 1e3);
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+    long sizes[MAX_LIST] = { 8, 16, 32, 64, 128, 256, 512, MAX_MTEXT };
+    long prods[MAX_LIST] = { 1, 2, 4 };
+    long cons[MAX_LIST] = { 1, 2, 4 };
+    int nSizes = 8, nProds = 3, nCons = 3;
+    int modes[2] = { 0, 1 }, nModes = 2, withTruncate = 0;
+    long messages = 100000;
+    struct shared *sh;
+    int opt, msqid, s, p, c, m, t;
+
+    while ((opt = getopt(argc, argv, "n:s:p:c:m:t")) != -1) {
+        switch (opt) {
+        case 'n': messages = atol(optarg); break;
+        case 's': nSizes = parseList(optarg, sizes); break;
+        case 'p': nProds = parseList(optarg, prods); break;
+        case 'c': nCons = parseList(optarg, cons); break;
+        case 'm':
+            nModes = 0;
+
+            if (strstr(optarg, "block") != NULL) {
+                modes[nModes++] = 0;
+            }
+
+            if (strstr(optarg, "nowait") != NULL) {
+                modes[nModes++] = 1;
+            }
+
+            break;
+        case 't': withTruncate = 1; break;
+        default:
+            fprintf(stderr, "Usage: %s [-n messages] [-s sizes] [-p producers] "
+                    "[-c consumers] [-m block,nowait] [-t]\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (nSizes < 1) {
+        sizes[0] = 0; /* Not a number: fails the range check below */
+        nSizes = 1;
+    }
+
+    for (s = 0; s < nSizes; s++) {
+        if (sizes[s] < (long) sizeof(long long) || sizes[s] > MAX_MTEXT) {
+            fprintf(stderr, "Payload sizes must be in %zu..%d\n", sizeof(long long), MAX_MTEXT);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (messages <= 0 || nModes == 0) {
+        fprintf(stderr, "Need messages > 0 and at least one receive mode\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (nProds < 1 || nCons < 1) {
+        fprintf(stderr, "Producer and consumer counts must be numbers >= 1\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (p = 0; p < nProds; p++) {
+        if (prods[p] > messages) {
+            fprintf(stderr, "More producers than messages\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    sh = mmap(NULL, sizeof(*sh) + messages * sizeof(long), PROT_READ | PROT_WRITE,
+              MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    if (sh == MAP_FAILED) {
+        perror("mmap");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Private queue: draining it between runs cannot eat anyone's messages */
+    msqid = benchQueue = msgget(IPC_PRIVATE, IPC_CREAT | S_IRUSR | S_IWUSR);
+
+    if (msqid == -1) {
+        perror("msgget");
+        exit(EXIT_FAILURE);
+    }
+
+    atexit(removeQueue);
+    printf("size,producers,consumers,recv_mode,truncate,messages,seconds,"
+           "msgs_per_sec,mb_per_sec,p50_us,p99_us,p999_us\n");
+
+    for (s = 0; s < nSizes; s++)
+        for (p = 0; p < nProds; p++)
+            for (c = 0; c < nCons; c++)
+                for (m = 0; m < nModes; m++)
+                    for (t = 0; t <= withTruncate; t++)
+                        if (!t || sizes[s] / 2 >= (long) sizeof(long long))
+                            runOne(msqid, sh, messages, sizes[s], prods[p], cons[c], modes[m], t);
+
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,135 @@
+/*
+ * Compile: gcc -o rate_agent rate_agent.c rate_limit.c
+ * Run: ./rate_agent buckets rate burst [tick-ms]
+ *
+ * Creates a set of token buckets (one semaphore each, all starting full),
+ * prints its ID for rate_client, and refills every bucket with 'rate'
+ * tokens per second until Ctrl+C. Ticks run on absolute deadlines so a
+ * late tick does not push the next ones back. Every second it reports
+ * the tokens clients took and how far the ticks were from schedule.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <sys/sem.h>
+#include <sys/stat.h>
+#include "sem.h"
+#include "rate_limit.h"
+
+#define REPORT_BUCKETS 4 /* Buckets listed by name in the report */
+
+static volatile sig_atomic_t stopping;
+
+static void intHandler(int sig)
+{
+    stopping = 1;
+}
+
+static double tsSec(const struct timespec *ts)
+{
+    return ts->tv_sec + ts->tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+    struct rl_agent a;
+    struct sigaction sa;
+    struct timespec next, now, last;
+    union semun dummy;
+    int nbuckets, burst, semid, ticks = 0, j;
+    long tickMs, prevTotal = 0, total;
+    double rate, late, lateSum = 0, lateMax = 0, reportAt;
+
+    if (argc < 4) {
+        fprintf(stderr, "Usage: %s buckets rate burst [tick-ms]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    nbuckets = atoi(argv[1]);
+    rate = atof(argv[2]);
+    burst = atoi(argv[3]);
+    tickMs = (argc > 4) ? atol(argv[4]) : 10;
+
+    semid = rlCreate(IPC_PRIVATE, nbuckets, burst, S_IRUSR | S_IWUSR);
+
+    if (semid == -1 || rlAgentInit(&a, semid, nbuckets, rate, burst) == -1) {
+        fprintf(stderr, "rlCreate error: %s\n", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    printf("Semaphore ID = %d (%d buckets, %.1f tokens/s, burst %d, tick %ld ms)\n",
+           semid, nbuckets, rate, burst, tickMs);
+    fflush(stdout);
+
+    memset(&sa, 0, sizeof(sa));
+    sigemptyset(&sa.sa_mask);
+    sa.sa_handler = intHandler;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    last = next;
+    reportAt = tsSec(&next) + 1;
+
+    while (!stopping) {
+        next.tv_nsec += tickMs * 1000000L;
+
+        while (next.tv_nsec >= 1000000000L) {
+            next.tv_nsec -= 1000000000L;
+            next.tv_sec++;
+        }
+
+        if (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) != 0) {
+            continue; /* Interrupted, 'stopping' is checked above */
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        late = tsSec(&now) - tsSec(&next);
+        lateSum += late;
+        lateMax = (late > lateMax) ? late : lateMax;
+        ticks++;
+
+        /* Refill for the time that really passed, not the nominal tick */
+        if (rlAgentTick(&a, tsSec(&now) - tsSec(&last)) == -1) {
+            fprintf(stderr, "rlAgentTick error: %s\n", strerror(errno));
+            break;
+        }
+
+        last = now;
+
+        if (tsSec(&now) < reportAt) {
+            continue;
+        }
+
+        for (j = 0, total = 0; j < nbuckets; j++) {
+            total += a.b[j].consumed;
+        }
+
+        printf("admitted %7ld/s |", total - prevTotal);
+
+        for (j = 0; j < nbuckets && j < REPORT_BUCKETS; j++) {
+            printf(" b%d=%ld", j, a.b[j].consumed); /* Taken so far */
+        }
+
+        printf(" | tick late avg %6.1f us max %7.1f us\n", lateSum / ticks * 1e6, lateMax * 1e6);
+        fflush(stdout);
+
+        prevTotal = total;
+        lateSum = lateMax = 0;
+        ticks = 0;
+        reportAt += 1;
+    }
+
+    rlAgentFree(&a);
+
+    if (semctl(semid, 0, IPC_RMID, dummy) == -1) {
+        fprintf(stderr, "semctl error");
+        exit(EXIT_FAILURE);
+    }
+
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,98 @@
+/*
+ * Compile: gcc -o rate_client rate_client.c rate_limit.c
+ * Run: ./rate_client semid bucket [processes] [seconds] [timeout-ms]
+ *      timeout-ms = 0 (default) is denied at once when the bucket is empty,
+ *      < 0 waits for a token as long as it takes
+ *
+ * Processes that each take one token at a time from the same bucket of a
+ * rate_agent set as fast as they can. Reports admitted and denied per
+ * second: the admitted rate should settle at the agent's rate however
+ * many processes there are.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "rate_limit.h"
+
+struct client_stats {
+    long admitted, denied;
+};
+
+static double nowSec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+    struct client_stats st, sum = { 0, 0 };
+    int semid, bucket, procs, fds[2];
+    double seconds, end;
+    long timeoutMs;
+
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s semid bucket [processes] [seconds] [timeout-ms]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    semid = atoi(argv[1]);
+    bucket = atoi(argv[2]);
+    procs = (argc > 3) ? atoi(argv[3]) : 4;
+    seconds = (argc > 4) ? atof(argv[4]) : 5;
+    timeoutMs = (argc > 5) ? atol(argv[5]) : 0;
+
+    if (pipe(fds) == -1) {
+        fprintf(stderr, "pipe error");
+        exit(EXIT_FAILURE);
+    }
+
+    end = nowSec() + seconds;
+
+    for (int j = 0; j < procs; j++) {
+        switch (fork()) {
+        case -1:
+            fprintf(stderr, "fork error");
+            exit(EXIT_FAILURE);
+
+        case 0:
+            st.admitted = st.denied = 0;
+
+            while (nowSec() < end) {
+                if (rlAcquire(semid, bucket, 1, timeoutMs) == 0) {
+                    st.admitted++;
+                } else if (errno == EAGAIN) {
+                    st.denied++;
+                } else if (errno != EINTR) {
+                    perror("rlAcquire");
+                    break;
+                }
+            }
+
+            write(fds[1], &st, sizeof(st));
+            _exit(EXIT_SUCCESS);
+        }
+    }
+
+    close(fds[1]);
+
+    while (read(fds[0], &st, sizeof(st)) == sizeof(st)) {
+        sum.admitted += st.admitted;
+        sum.denied += st.denied;
+    }
+
+    while (wait(NULL) > 0) {
+        continue;
+    }
+
+    printf("%d processes, bucket %d, %.1f s, timeout %ld ms\n", procs, bucket, seconds, timeoutMs);
+    printf("admitted %10.1f/s (%ld)\n", sum.admitted / seconds, sum.admitted);
+    printf("denied   %10.1f/s (%ld)\n", sum.denied / seconds, sum.denied);
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,143 @@
+#define _GNU_SOURCE /* semtimedop() */
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/sem.h>
+#include "sem.h"
+#include "rate_limit.h"
+
+int rlCreate(key_t key, int nbuckets, int burst, int perms)
+{
+    union semun arg;
+    int semid, j;
+
+    if (nbuckets < 1 || burst < 1 || burst > RL_MAX_TOKENS) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    semid = semget(key, nbuckets, IPC_CREAT | perms);
+
+    if (semid == -1) {
+        return -1;
+    }
+
+    arg.array = calloc(nbuckets, sizeof(arg.array[0]));
+
+    if (arg.array == NULL) {
+        return -1;
+    }
+
+    for (j = 0; j < nbuckets; j++) {
+        arg.array[j] = burst;
+    }
+
+    j = semctl(semid, 0, SETALL, arg);
+    free(arg.array);
+
+    return (j == -1) ? -1 : semid;
+}
+
+int rlAcquire(int semid, int bucket, int tokens, long timeoutMs)
+{
+    struct sembuf sop;
+    struct timespec ts;
+
+    sop.sem_num = bucket;
+    sop.sem_op = -tokens;
+    sop.sem_flg = (timeoutMs == 0) ? IPC_NOWAIT : 0;
+
+    if (timeoutMs <= 0) {
+        return semop(semid, &sop, 1);
+    }
+
+    ts.tv_sec = timeoutMs / 1000;
+    ts.tv_nsec = (timeoutMs % 1000) * 1000000L;
+    return semtimedop(semid, &sop, 1, &ts); /* EAGAIN on timeout too */
+}
+
+int rlAgentInit(struct rl_agent *a, int semid, int nbuckets, double rate, int burst)
+{
+    struct seminfo info;
+    union semun arg;
+
+    arg.__buf = &info;
+    a->maxOps = (semctl(0, 0, IPC_INFO, arg) == -1) ? 32 : info.semopm;
+    a->semid = semid;
+    a->nbuckets = nbuckets;
+    a->b = calloc(nbuckets, sizeof(a->b[0]));
+    a->vals = calloc(nbuckets, sizeof(a->vals[0]));
+    a->sops = calloc(nbuckets, sizeof(a->sops[0]));
+
+    if (a->b == NULL || a->vals == NULL || a->sops == NULL) {
+        rlAgentFree(a);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    for (int j = 0; j < nbuckets; j++) {
+        a->b[j].rate = rate;
+        a->b[j].burst = burst;
+        a->b[j].left = burst; /* rlCreate() filled them */
+    }
+
+    return 0;
+}
+
+int rlAgentTick(struct rl_agent *a, double elapsedSec)
+{
+    union semun arg;
+    int j, done, nsops = 0;
+
+    arg.array = a->vals;
+
+    if (semctl(a->semid, 0, GETALL, arg) == -1) {
+        return -1;
+    }
+
+    for (j = 0; j < a->nbuckets; j++) {
+        struct rl_bucket *b = &a->b[j];
+        double owed = b->rate * elapsedSec + b->carry;
+        int add = (int) owed;
+
+        /* Only clients run between GETALL and our semop(), and they only
+           take tokens, so capping against this snapshot cannot overshoot */
+        b->consumed += (a->vals[j] < b->left) ? b->left - a->vals[j] : 0;
+        b->carry = owed - add;
+
+        if (add > b->burst - a->vals[j]) {
+            add = b->burst - a->vals[j];
+            b->carry = 0; /* Full bucket: what did not fit is lost */
+        }
+
+        b->left = a->vals[j] + add;
+
+        if (add > 0) {
+            a->sops[nsops].sem_num = j;
+            a->sops[nsops].sem_op = add;
+            a->sops[nsops].sem_flg = 0;
+            nsops++;
+        }
+    }
+
+    /* As few calls as SEMOPM allows, each wakes whoever waits on its buckets */
+    for (done = 0; done < nsops; done += a->maxOps) {
+        int n = (nsops - done < a->maxOps) ? nsops - done : a->maxOps;
+
+        if (semop(a->semid, a->sops + done, n) == -1) {
+            return -1;
+        }
+    }
+
+    return nsops;
+}
+
+void rlAgentFree(struct rl_agent *a)
+{
+    free(a->b);
+    free(a->vals);
+    free(a->sops);
+    a->b = NULL;
+    a->vals = NULL;
+    a->sops = NULL;
+}
@@ -0,0 +1,38 @@
+#ifndef RATE_LIMIT_H
+#define RATE_LIMIT_H /* Prevent accidental double inclusion */
+#include <sys/types.h>
+#include <sys/sem.h>
+
+/* Token buckets shared by any number of processes. Semaphore j of the set
+   holds the tokens of bucket j: clients take them with semop(-n), one
+   refill agent puts them back on a timer. */
+#define RL_MAX_TOKENS 32767 /* SEMVMX, the largest value a semaphore holds */
+
+struct rl_bucket { /* Agent-side state of one bucket */
+    double rate; /* Tokens added per second */
+    int burst; /* Capacity, tokens never exceed it */
+    double carry; /* Fraction of a token owed from earlier ticks */
+    unsigned short left; /* Value right after our last refill */
+    long consumed; /* Tokens taken by clients so far */
+};
+
+struct rl_agent {
+    int semid;
+    int nbuckets;
+    int maxOps; /* SEMOPM, operations one semop() accepts */
+    struct rl_bucket *b;
+    unsigned short *vals; /* GETALL scratch */
+    struct sembuf *sops; /* One refill operation per bucket */
+};
+
+int rlCreate(key_t key, int nbuckets, int burst, int perms); /* Buckets start full */
+
+/* Take 'tokens' from a bucket. timeoutMs: 0 = don't wait, < 0 = wait as
+   long as it takes. Denied (or timed out) is -1 with errno EAGAIN. */
+int rlAcquire(int semid, int bucket, int tokens, long timeoutMs);
+
+int rlAgentInit(struct rl_agent *a, int semid, int nbuckets, double rate, int burst);
+int rlAgentTick(struct rl_agent *a, double elapsedSec); /* GETALL + one semop() */
+void rlAgentFree(struct rl_agent *a);
+
+#endif
@@ -6,6 +6,9 @@ union semun { /* Used in calls to semctl() */
     int val; /* Value for SETVAL */
     struct semid_ds * buf; /* Buffer for IPC_STAT, IPC_SET */
     unsigned short * array; /* Array for GETALL, SETALL */
+#if defined(__linux__)
+    struct seminfo * __buf; /* Buffer for IPC_INFO */
+#endif
 };
 
 char * currTime(const char *format);
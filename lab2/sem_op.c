@@ -1,38 +1,76 @@
+/*
+ * Compile: gcc -o sem_op sem_op.c curr_time.c trace.c
+ * Run: ./sem_op sem_id operation [count]
+ *      SEM_TRACE=/tmp/semop ./sem_op ...  records every semop() in
+ *      /tmp/semop.<pid> instead of printing times, read it with trace_dump
+ */
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <errno.h>
 #include <sys/sem.h>
 #include <sys/stat.h>
 #include "sem.h"
+#include "trace.h"
 
 int main(int argc, char *argv[])
 {
-    int semid;
+    int semid, s;
+    long count;
+    char path[4096];
+    const char *traceBase = getenv("SEM_TRACE");
 
-    if (argc != 3) {
+    if (argc != 3 && argc != 4) {
         fprintf(
             stderr,
-            "Usage error: the program accepts exactly 2 arguments in the following format:\n"
-            "%s sem_id operation\n",
+            "Usage error: the program accepts 2 or 3 arguments in the following format:\n"
+            "%s sem_id operation [count]\n",
             argv[0]
         );
         exit(EXIT_FAILURE);
     }
 
+    if (traceBase != NULL) {
+        snprintf(path, sizeof(path), "%s.%ld", traceBase, (long) getpid());
+
+        if (traceOpen(path) == -1) {
+            fprintf(stderr, "traceOpen error");
+            exit(EXIT_FAILURE);
+        }
+    }
+
     struct sembuf sop; /* Structure defining operation */
     semid = atoi(argv[1]);
     sop.sem_num = 0; /* Specifies first semaphore in set */
     sop.sem_op = atoi(argv[2]); /* Add, subtract, or wait for 0 */
     sop.sem_flg = 0; /* No special options for operation */
+    count = (argc == 4) ? atol(argv[3]) : 1;
 
-    printf("%ld: about to semop at %s\n", (long) getpid(), currTime("%T"));
+    for (long j = 0; j < count; j++) {
+        if (traceBase == NULL) {
+            printf("%ld: about to semop at %s\n", (long) getpid(), currTime("%T"));
+        }
 
-    if (semop(semid, &sop, 1) == -1) {
-        fprintf(stderr, "semop error");
-        exit(EXIT_FAILURE);
+        traceEvent(TRACE_SEMOP_BEGIN, semid, sop.sem_num, sop.sem_op);
+        s = semop(semid, &sop, 1);
+        traceEvent(TRACE_SEMOP_END, semid, s, (s == -1) ? errno : 0);
+
+        if (s == -1) {
+            fprintf(stderr, "semop error");
+            exit(EXIT_FAILURE);
+        }
+
+        if (traceBase == NULL) {
+            printf("%ld: semop completed at %s\n", (long) getpid(), currTime("%T"));
+        }
+    }
+
+    if (traceBase != NULL) {
+        traceClose();
+        printf("%ld: %ld semop calls traced to %s\n", (long) getpid(), count, path);
     }
 
-    printf("%ld: semop completed at %s\n", (long) getpid(), currTime("%T"));
     exit(EXIT_SUCCESS);
 }
@@ -0,0 +1,318 @@
+/*
+ * Compile: gcc -o sem_sample sem_sample.c
+ * Run: ./sem_sample semid [interval-ms] [seconds] [csv-file]
+ *      seconds = 0 (default) samples until Ctrl+C
+ *
+ * Contention sampler for large semaphore sets. Where sem_get_info makes
+ * three semctl() calls per semaphore, every sample here costs IPC_STAT plus
+ * one GETALL, and GETNCNT/GETZCNT go only to a bounded number of semaphores:
+ * those with waiters last time and those whose value moved, taken in turn
+ * from where the previous sample stopped, and at least QUERY_ROTATE from a
+ * rotating cursor that refreshes the whole set every nsems / QUERY_ROTATE
+ * samples even when there are more busy semaphores than the budget.
+ *
+ * Each second it prints one heatmap row, one column per group of
+ * semaphores, shaded by the most waiters seen in the group. The csv file
+ * gets the same rows with numbers. On exit the busiest semaphores are listed.
+ */
+
+#define _GNU_SOURCE /* qsort_r() */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/sem.h>
+#include "sem.h"
+
+#define QUERY_BUDGET 64 /* Semaphores given GETNCNT/GETZCNT per sample */
+#define QUERY_ROTATE 16 /* Of which kept for the rotating refresh */
+#define HEAT_COLS 64 /* Heatmap width, semaphores are grouped to fit */
+#define TOP_N 10
+
+struct sem_stat {
+    unsigned short val; /* From the latest GETALL */
+    int ncnt, zcnt; /* Last queried waiter counts */
+    int pid; /* Last semop() caller, queried when the value moved */
+    int dirty; /* Value moved since the last waiter query */
+    long ops; /* Sum of |value change|, a lower bound on semop() calls */
+    double waitSum; /* Waiters summed over samples */
+    int waitMax;
+    long periodOps; /* Same, for the current heatmap row */
+    double periodWait;
+};
+
+static volatile sig_atomic_t stopping;
+
+static void intHandler(int sig)
+{
+    stopping = 1;
+}
+
+static double nowSec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char shade(double waiters) /* Log scale so rows stay comparable */
+{
+    static const char levels[] = " .:-=+*#%@";
+    int l = 0;
+
+    if (waiters > 0) {
+        for (l = 1; l < 9 && waiters >= 0.5 * (1 << (l - 1)); l++) {
+            continue;
+        }
+    }
+
+    return levels[l];
+}
+
+static void queryWaiters(int semid, int j, struct sem_stat *s, long *calls)
+{
+    union semun dummy;
+
+    s[j].ncnt = semctl(semid, j, GETNCNT, dummy);
+    s[j].zcnt = semctl(semid, j, GETZCNT, dummy);
+    *calls += 2;
+
+    if (s[j].dirty) {
+        s[j].pid = semctl(semid, j, GETPID, dummy);
+        (*calls)++;
+    }
+
+    s[j].dirty = 0;
+}
+
+static int cmpBusy(const void *a, const void *b, void *arg)
+{
+    const struct sem_stat *s = arg;
+    int x = *(const int *) a, y = *(const int *) b;
+
+    if (s[x].waitSum != s[y].waitSum) {
+        return (s[x].waitSum < s[y].waitSum) ? 1 : -1;
+    }
+
+    if (s[x].ops != s[y].ops) {
+        return (s[x].ops < s[y].ops) ? 1 : -1;
+    }
+
+    return (x > y) - (x < y); /* Lowest number first */
+}
+
+int main(int argc, char *argv[])
+{
+    struct semid_ds ds;
+    struct sem_stat *s;
+    struct sigaction sa;
+    union semun arg;
+    unsigned short *vals;
+    int semid, nsems, j, g, cols, queried, cursor = 0, hotCursor = 0, *order;
+    long intervalMs, samples = 0, periodSamples = 0, calls = 0;
+    double seconds, start, periodStart, now;
+    FILE *csv = NULL;
+
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s semid [interval-ms] [seconds] [csv-file]\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    semid = atoi(argv[1]);
+    intervalMs = (argc > 2) ? atol(argv[2]) : 100;
+    seconds = (argc > 3) ? atof(argv[3]) : 0;
+
+    if (argc > 4 && (csv = fopen(argv[4], "w")) == NULL) {
+        fprintf(stderr, "fopen error");
+        exit(EXIT_FAILURE);
+    }
+
+    arg.buf = &ds;
+
+    if (semctl(semid, 0, IPC_STAT, arg) == -1) {
+        fprintf(stderr, "semctl error");
+        exit(EXIT_FAILURE);
+    }
+
+    nsems = ds.sem_nsems;
+    cols = (nsems < HEAT_COLS) ? nsems : HEAT_COLS;
+    s = calloc(nsems, sizeof(s[0]));
+    vals = calloc(nsems, sizeof(vals[0]));
+    order = calloc(nsems, sizeof(order[0]));
+
+    if (s == NULL || vals == NULL || order == NULL) {
+        fprintf(stderr, "calloc error");
+        exit(EXIT_FAILURE);
+    }
+
+    memset(&sa, 0, sizeof(sa));
+    sigemptyset(&sa.sa_mask);
+    sa.sa_handler = intHandler;
+    sigaction(SIGINT, &sa, NULL);
+
+    /* Baseline: one full query so waiter counts start out known */
+    arg.array = vals;
+
+    if (semctl(semid, 0, GETALL, arg) == -1) {
+        fprintf(stderr, "semctl-GETALL error");
+        exit(EXIT_FAILURE);
+    }
+
+    for (j = 0; j < nsems; j++) {
+        s[j].val = vals[j];
+        s[j].dirty = 1;
+        queryWaiters(semid, j, s, &calls);
+    }
+
+    printf("%d semaphores, %d per heatmap column, shade = most waiters in column\n",
+           nsems, (nsems + cols - 1) / cols);
+    printf("time     |%*s|\n", cols, "");
+
+    if (csv != NULL) {
+        fprintf(csv, "time");
+
+        for (g = 0; g < cols; g++) {
+            fprintf(csv, ",waiters_%d,ops_%d", g * nsems / cols, g * nsems / cols);
+        }
+
+        fprintf(csv, "\n");
+    }
+
+    calls = 0;
+    start = periodStart = nowSec();
+
+    while (!stopping && (seconds <= 0 || nowSec() - start < seconds)) {
+        usleep(intervalMs * 1000);
+        arg.buf = &ds;
+
+        if (semctl(semid, 0, IPC_STAT, arg) == -1) {
+            fprintf(stderr, "semctl error"); /* Set removed */
+            break;
+        }
+
+        arg.array = vals;
+
+        if (semctl(semid, 0, GETALL, arg) == -1) {
+            fprintf(stderr, "semctl-GETALL error");
+            break;
+        }
+
+        calls += 2;
+        samples++;
+        periodSamples++;
+
+        for (j = 0; j < nsems; j++) {
+            if (vals[j] != s[j].val) {
+                long d = abs((int) vals[j] - (int) s[j].val);
+
+                s[j].ops += d;
+                s[j].periodOps += d;
+                s[j].val = vals[j];
+                s[j].dirty = 1;
+            }
+        }
+
+        /* Spend the query budget where waiters are likely, then rotate */
+        queried = 0;
+
+        for (g = 0; g < nsems && queried < QUERY_BUDGET - QUERY_ROTATE; g++) {
+            j = (hotCursor + g) % nsems;
+
+            if (s[j].dirty || s[j].ncnt + s[j].zcnt > 0) {
+                queryWaiters(semid, j, s, &calls);
+                queried++;
+            }
+        }
+
+        hotCursor = (hotCursor + g) % nsems; /* Next sample goes on after j */
+
+        for (; queried < QUERY_BUDGET && queried < nsems; queried++) {
+            queryWaiters(semid, cursor, s, &calls);
+            cursor = (cursor + 1) % nsems;
+        }
+
+        for (j = 0; j < nsems; j++) {
+            int w = s[j].ncnt + s[j].zcnt;
+
+            s[j].waitSum += w;
+            s[j].periodWait += w;
+            s[j].waitMax = (w > s[j].waitMax) ? w : s[j].waitMax;
+        }
+
+        now = nowSec();
+
+        if (now - periodStart < 1.0) {
+            continue;
+        }
+
+        /* One heatmap row per second */
+        printf("%8.1f |", now - start);
+
+        if (csv != NULL) {
+            fprintf(csv, "%.1f", now - start);
+        }
+
+        for (g = 0; g < cols; g++) {
+            double hot = 0;
+            long ops = 0;
+
+            for (j = g * nsems / cols; j < (g + 1) * nsems / cols; j++) {
+                double w = s[j].periodWait / periodSamples;
+
+                hot = (w > hot) ? w : hot;
+                ops += s[j].periodOps;
+                s[j].periodWait = 0;
+                s[j].periodOps = 0;
+            }
+
+            putchar(shade(hot));
+
+            if (csv != NULL) {
+                fprintf(csv, ",%.2f,%.1f", hot, ops / (now - periodStart));
+            }
+        }
+
+        printf("|\n");
+        fflush(stdout);
+
+        if (csv != NULL) {
+            fprintf(csv, "\n");
+        }
+
+        periodStart = now;
+        periodSamples = 0;
+    }
+
+    now = nowSec();
+
+    for (j = 0; j < nsems; j++) {
+        order[j] = j;
+    }
+
+    qsort_r(order, nsems, sizeof(order[0]), cmpBusy, s);
+
+    printf("\n%ld samples in %.1f s, %.1f semctl calls per sample "
+           "(%d per sample with GETPID/GETNCNT/GETZCNT for all)\n",
+           samples, now - start, samples ? (double) calls / samples : 0.0, 3 * nsems + 2);
+    printf("Sem #  ops/sec  avg-waiters  max-waiters  last-pid\n");
+
+    for (j = 0; j < nsems && j < TOP_N; j++) {
+        struct sem_stat *t = &s[order[j]];
+
+        if (t->waitSum == 0 && t->ops == 0) {
+            break;
+        }
+
+        printf("%5d %8.1f %12.2f %12d %9d\n", order[j], t->ops / (now - start),
+               samples ? t->waitSum / samples : 0.0, t->waitMax, t->pid);
+    }
+
+    if (csv != NULL) {
+        fclose(csv);
+    }
+
+    exit(EXIT_SUCCESS);
+}
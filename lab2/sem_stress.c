@@ -0,0 +1,370 @@
+/*
+ * Compile: gcc -O2 -o sem_stress sem_stress.c
+ * Run: ./sem_stress [-p procs] [-t seconds] [-v init-value] [-n nsems]
+ *                   [-w work-usec] [-o pattern]...
+ *
+ * Contention harness: 'procs' processes hammer one semaphore set for a
+ * fixed time, each repeating the -o patterns in order, one semop() per
+ * pattern. A pattern is a sembuf array written as num:op[flags] items
+ * separated by commas, flags n = IPC_NOWAIT and u = SEM_UNDO, op 0 waits
+ * for zero. The default "-o 0:-3 -o 0:+3" is home/ex2.c and ex4.c in a
+ * loop. -w spins after every semop() to stand in for the critical section.
+ *
+ *   ./sem_stress -p 8 -o 0:-1u -o 0:+1u                   one lock
+ *   ./sem_stress -p 8 -n 2 -o 0:-1,1:-1 -o 0:+1,1:+1      two at once
+ *   ./sem_stress -p 8 -v 1 -o 0:-1n -o 0:+1               trylock
+ *
+ * Reports total semop() calls per second, each process's share with the
+ * Jain fairness index (1 = perfectly even, 1/procs = one process gets
+ * everything), a histogram of the time spent inside semop() and the
+ * voluntary/involuntary context switches from getrusage().
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/sem.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "sem.h"
+
+#define MAX_PATTERNS 16
+#define MAX_OPS 32 /* sembufs per pattern */
+#define HIST_BUCKETS 24 /* <1 us, then powers of two up to ~8 s */
+
+struct pattern {
+    struct sembuf sops[MAX_OPS];
+    int nsops;
+    char text[64];
+};
+
+struct proc_stat { /* One per process, in shared memory */
+    pid_t pid;
+    long ops; /* Successful semop() calls */
+    long eagain; /* IPC_NOWAIT calls that would have blocked */
+    double waitSum; /* Seconds spent inside semop() */
+    long hist[HIST_BUCKETS];
+    long nvcsw, nivcsw;
+};
+
+struct stress_shared {
+    int stop; /* Set by the parent when time is up */
+    struct proc_stat st[];
+};
+
+static double nowSec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int bucket(double sec) /* 0: < 1 us, b: [2^(b-1), 2^b) us */
+{
+    double us = sec * 1e6;
+    int b = 0;
+
+    while (us >= 1 && b < HIST_BUCKETS - 1) {
+        us /= 2;
+        b++;
+    }
+
+    return b;
+}
+
+static int parsePattern(const char *text, struct pattern *p, int *maxSem)
+{
+    char buf[sizeof(p->text)], *item, *save, *end;
+
+    if (strlen(text) >= sizeof(buf)) {
+        return -1;
+    }
+
+    strcpy(buf, text);
+    strcpy(p->text, text);
+    p->nsops = 0;
+
+    for (item = strtok_r(buf, ",", &save); item != NULL; item = strtok_r(NULL, ",", &save)) {
+        struct sembuf *op = &p->sops[p->nsops];
+        long num, val;
+
+        if (p->nsops == MAX_OPS) {
+            return -1;
+        }
+
+        num = strtol(item, &end, 10);
+
+        if (end == item || *end != ':' || num < 0) {
+            return -1;
+        }
+
+        item = end + 1;
+        val = strtol(item, &end, 10);
+
+        if (end == item) {
+            return -1;
+        }
+
+        op->sem_num = num;
+        op->sem_op = val;
+        op->sem_flg = 0;
+
+        for (; *end != '\0'; end++) {
+            if (*end == 'n') {
+                op->sem_flg |= IPC_NOWAIT;
+            } else if (*end == 'u') {
+                op->sem_flg |= SEM_UNDO;
+            } else {
+                return -1;
+            }
+        }
+
+        *maxSem = (num > *maxSem) ? num : *maxSem;
+        p->nsops++;
+    }
+
+    return (p->nsops > 0) ? 0 : -1;
+}
+
+static void spin(double sec) /* Busy work, sleeping would hide the contention */
+{
+    double until = nowSec() + sec;
+
+    while (nowSec() < until) {
+        continue;
+    }
+}
+
+static void worker(int semid, struct pattern *pats, int npats, double work,
+                   volatile int *stop, int gate, struct proc_stat *st)
+{
+    struct rusage ru;
+    char c;
+    int j = 0;
+
+    read(gate, &c, 1); /* Returns 0 when the parent closes the write end */
+
+    while (!*stop) {
+        double t = nowSec();
+
+        if (semop(semid, pats[j].sops, pats[j].nsops) == -1) {
+            if (errno == EIDRM || errno == EINVAL) {
+                break; /* Time is up, the parent removed the set */
+            }
+
+            if (errno == EAGAIN) {
+                st->eagain++;
+                continue; /* Retry the same pattern */
+            }
+
+            if (errno != EINTR) {
+                fprintf(stderr, "semop error");
+                _exit(EXIT_FAILURE);
+            }
+
+            continue;
+        }
+
+        t = nowSec() - t;
+        st->ops++;
+        st->waitSum += t;
+        st->hist[bucket(t)]++;
+
+        if (work > 0) {
+            spin(work);
+        }
+
+        j = (j + 1) % npats;
+    }
+
+    getrusage(RUSAGE_SELF, &ru);
+    st->nvcsw = ru.ru_nvcsw;
+    st->nivcsw = ru.ru_nivcsw;
+    _exit(EXIT_SUCCESS);
+}
+
+static double percentile(const long *hist, long total, double q) /* Bucket's upper bound, us */
+{
+    long seen = 0;
+
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        seen += hist[b];
+
+        if (seen >= q * total) {
+            return (double) (1L << b);
+        }
+    }
+
+    return (double) (1L << (HIST_BUCKETS - 1));
+}
+
+int main(int argc, char *argv[])
+{
+    struct pattern pats[MAX_PATTERNS];
+    struct stress_shared *sh;
+    struct proc_stat *st, all;
+    union semun arg;
+    unsigned short *vals;
+    int opt, npats = 0, procs = 4, nsems = 0, initVal = 3, maxSem = -1, semid, gate[2];
+    double seconds = 5, work = 0, start, elapsed, sum = 0, sumSq = 0;
+    long maxHist = 0;
+    pid_t pid;
+
+    while ((opt = getopt(argc, argv, "p:t:v:n:w:o:")) != -1) {
+        switch (opt) {
+        case 'p': procs = atoi(optarg); break;
+        case 't': seconds = atof(optarg); break;
+        case 'v': initVal = atoi(optarg); break;
+        case 'n': nsems = atoi(optarg); break;
+        case 'w': work = atof(optarg) / 1e6; break;
+
+        case 'o':
+            if (npats == MAX_PATTERNS || parsePattern(optarg, &pats[npats], &maxSem) == -1) {
+                fprintf(stderr, "bad pattern '%s', expected num:op[nu],...\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+
+            npats++;
+            break;
+
+        default:
+            fprintf(stderr, "Usage: %s [-p procs] [-t seconds] [-v init-value] [-n nsems] "
+                    "[-w work-usec] [-o pattern]...\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (npats == 0) {
+        parsePattern("0:-3", &pats[npats++], &maxSem);
+        parsePattern("0:+3", &pats[npats++], &maxSem);
+    }
+
+    nsems = (nsems > maxSem) ? nsems : maxSem + 1;
+
+    if (procs < 1) {
+        fprintf(stderr, "procs must be at least 1\n");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Statistics and the stop flag live in memory the children share */
+    sh = mmap(NULL, sizeof(*sh) + procs * sizeof(sh->st[0]), PROT_READ | PROT_WRITE,
+              MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+    if (sh == MAP_FAILED) {
+        fprintf(stderr, "mmap error");
+        exit(EXIT_FAILURE);
+    }
+
+    st = sh->st;
+    semid = semget(IPC_PRIVATE, nsems, IPC_CREAT | S_IRUSR | S_IWUSR);
+    vals = calloc(nsems, sizeof(vals[0]));
+
+    if (semid == -1 || vals == NULL) {
+        fprintf(stderr, "semget error");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int j = 0; j < nsems; j++) {
+        vals[j] = initVal;
+    }
+
+    arg.array = vals;
+
+    if (semctl(semid, 0, SETALL, arg) == -1 || pipe(gate) == -1) {
+        fprintf(stderr, "setup error");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int j = 0; j < procs; j++) {
+        switch (pid = fork()) {
+        case -1:
+            fprintf(stderr, "fork error");
+            exit(EXIT_FAILURE);
+
+        case 0:
+            close(gate[1]);
+            worker(semid, pats, npats, work, &sh->stop, gate[0], &st[j]);
+        }
+
+        st[j].pid = pid;
+    }
+
+    /* Everyone is forked: open the gate, run, then stop and pull the set
+       from under whoever is still blocked */
+    close(gate[0]);
+    start = nowSec();
+    close(gate[1]);
+    usleep(seconds * 1e6);
+    sh->stop = 1;
+    elapsed = nowSec() - start;
+    semctl(semid, 0, IPC_RMID);
+
+    while (wait(NULL) > 0) {
+        continue;
+    }
+
+    printf("%d processes, %d semaphores = %d, %.1f s, %.0f us work, patterns:",
+           procs, nsems, initVal, elapsed, work * 1e6);
+
+    for (int j = 0; j < npats; j++) {
+        printf(" %s", pats[j].text);
+    }
+
+    printf("\n\n    pid        ops  share%%     eagain  avg-wait-us     vcsw    ivcsw\n");
+    memset(&all, 0, sizeof(all));
+
+    for (int j = 0; j < procs; j++) {
+        sum += st[j].ops;
+        sumSq += (double) st[j].ops * st[j].ops;
+        all.ops += st[j].ops;
+        all.eagain += st[j].eagain;
+        all.waitSum += st[j].waitSum;
+        all.nvcsw += st[j].nvcsw;
+        all.nivcsw += st[j].nivcsw;
+
+        for (int b = 0; b < HIST_BUCKETS; b++) {
+            all.hist[b] += st[j].hist[b];
+        }
+    }
+
+    for (int j = 0; j < procs; j++) {
+        printf("%7ld %10ld %7.2f %10ld %12.2f %8ld %8ld\n", (long) st[j].pid, st[j].ops,
+               all.ops ? 100.0 * st[j].ops / all.ops : 0.0, st[j].eagain,
+               st[j].ops ? st[j].waitSum / st[j].ops * 1e6 : 0.0, st[j].nvcsw, st[j].nivcsw);
+    }
+
+    printf("\n%.0f semop/sec, Jain fairness %.3f (1/procs = %.3f)\n",
+           all.ops / elapsed, sumSq > 0 ? sum * sum / (procs * sumSq) : 0.0, 1.0 / procs);
+    printf("%.2f voluntary, %.2f involuntary context switches per semop, %.1f%% EAGAIN\n",
+           all.ops ? (double) all.nvcsw / all.ops : 0.0, all.ops ? (double) all.nivcsw / all.ops : 0.0,
+           all.ops + all.eagain ? 100.0 * all.eagain / (all.ops + all.eagain) : 0.0);
+
+    if (all.ops == 0) {
+        exit(EXIT_SUCCESS);
+    }
+
+    printf("time in semop(): p50 < %.0f us, p99 < %.0f us, p99.9 < %.0f us\n\n",
+           percentile(all.hist, all.ops, 0.5), percentile(all.hist, all.ops, 0.99),
+           percentile(all.hist, all.ops, 0.999));
+
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        maxHist = (all.hist[b] > maxHist) ? all.hist[b] : maxHist;
+    }
+
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        if (all.hist[b] == 0) {
+            continue;
+        }
+
+        printf(" < %9ld us |%-50.*s| %ld\n", 1L << b, (int) (50 * all.hist[b] / maxHist),
+               "##################################################", all.hist[b]);
+    }
+
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,52 @@
+#ifndef TRACE_H
+#define TRACE_H /* Prevent accidental double inclusion */
+#include <stdint.h>
+#include <sys/types.h>
+
+/* Binary event tracing. Each thread owns one ring in a file mapped with
+   MAP_SHARED, so recording an event is a clock read and a 32-byte store:
+   no locks, no formatting, and the data survives a crash. A full ring
+   overwrites its oldest events. trace_dump formats and merges the files
+   afterwards; CLOCK_MONOTONIC is system-wide, so traces from several
+   processes line up. */
+#define TRACE_MAGIC 0x54524331 /* "TRC1" */
+#define TRACE_MAX_THREADS 64
+#define TRACE_RING_EVENTS 8192 /* Per thread, must be a power of 2 */
+
+/* Event IDs. An odd ID opens a span and ID + 1 closes it on the same
+   thread; trace_dump reports the latency of each span. */
+#define TRACE_SEMOP_BEGIN 1 /* args: semid, sem_num, sem_op */
+#define TRACE_SEMOP_END 2 /* args: semid, result, errno */
+#define TRACE_MARK 100 /* args: user defined */
+
+struct trace_event {
+    uint64_t ns; /* CLOCK_MONOTONIC */
+    uint32_t id;
+    int32_t arg0;
+    int64_t arg1, arg2;
+};
+
+struct trace_ring {
+    int32_t tid;
+    uint32_t pad;
+    uint64_t head; /* Events ever written, the ring holds the last ones */
+    struct trace_event ev[TRACE_RING_EVENTS];
+};
+
+struct trace_file {
+    uint32_t magic;
+    int32_t pid;
+    uint32_t nrings; /* Rings claimed so far */
+    uint32_t dropped; /* Threads that found no free ring */
+    uint64_t monoStart, realStart; /* Clock pair for wall-clock output */
+    struct trace_ring rings[TRACE_MAX_THREADS];
+};
+
+/* traceEvent() after traceClose() is a no-op, after a new traceOpen() it
+   claims a ring in the new file; a fork() child claims its own ring too.
+   traceClose() must not run while other threads are inside traceEvent(). */
+int traceOpen(const char *path); /* Creates path, sparse until threads write */
+void traceEvent(uint32_t id, int32_t arg0, int64_t arg1, int64_t arg2);
+int traceClose(void);
+
+#endif
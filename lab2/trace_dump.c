@@ -0,0 +1,239 @@
+/*
+ * Compile: gcc -o trace_dump trace_dump.c
+ * Run: ./trace_dump [-s] trace-file...
+ *      -s prints only the span latency summary
+ *
+ * Offline side of trace.h: merges the rings of all given files in time
+ * order, prints one line per event with wall-clock time, and summarizes
+ * the latency of each span (odd ID opened, ID + 1 closed, same thread).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "trace.h"
+
+#define MAX_FILES 64
+#define MAX_SPANS 32 /* Span kinds tracked: IDs 1/2, 3/4, ... 63/64 */
+
+struct loaded { /* One event with where it came from */
+    struct trace_event ev;
+    int file, ring;
+};
+
+static const char *eventName(uint32_t id)
+{
+    switch (id) {
+    case TRACE_SEMOP_BEGIN:
+        return "semop-begin";
+    case TRACE_SEMOP_END:
+        return "semop-end";
+    case TRACE_MARK:
+        return "mark";
+    default:
+        return "event";
+    }
+}
+
+static const char *spanName(uint32_t beginId)
+{
+    return (beginId == TRACE_SEMOP_BEGIN) ? "semop" : "span";
+}
+
+static int cmpEvent(const void *a, const void *b)
+{
+    uint64_t x = ((const struct loaded *) a)->ev.ns, y = ((const struct loaded *) b)->ev.ns;
+
+    return (x > y) - (x < y);
+}
+
+static int cmpU64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *) a, y = *(const uint64_t *) b;
+
+    return (x > y) - (x < y);
+}
+
+int main(int argc, char *argv[])
+{
+    const struct trace_file *files[MAX_FILES];
+    struct loaded *all = NULL;
+    uint64_t *openNs, *lat[MAX_SPANS] = { NULL };
+    size_t n = 0, cap = 0, nlat[MAX_SPANS] = { 0 };
+    int nfiles = 0, summaryOnly = 0, f, r, ringBase[MAX_FILES + 1];
+
+    for (int j = 1; j < argc; j++) {
+        struct stat st;
+        int fd;
+
+        if (strcmp(argv[j], "-s") == 0) {
+            summaryOnly = 1;
+            continue;
+        }
+
+        if (nfiles == MAX_FILES) {
+            fprintf(stderr, "Too many files\n");
+            exit(EXIT_FAILURE);
+        }
+
+        if ((fd = open(argv[j], O_RDONLY)) == -1 || fstat(fd, &st) == -1) {
+            perror(argv[j]);
+            exit(EXIT_FAILURE);
+        }
+
+        if (st.st_size < (off_t) sizeof(struct trace_file)) {
+            fprintf(stderr, "%s: not a trace file\n", argv[j]);
+            exit(EXIT_FAILURE);
+        }
+
+        files[nfiles] = mmap(NULL, sizeof(struct trace_file), PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+
+        if (files[nfiles] == MAP_FAILED || files[nfiles]->magic != TRACE_MAGIC) {
+            fprintf(stderr, "%s: not a trace file\n", argv[j]);
+            exit(EXIT_FAILURE);
+        }
+
+        nfiles++;
+    }
+
+    if (nfiles == 0) {
+        fprintf(stderr, "Usage: %s [-s] trace-file...\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    /* Collect what each ring still holds */
+    ringBase[0] = 0;
+
+    for (f = 0; f < nfiles; f++) {
+        const struct trace_file *t = files[f];
+        uint32_t nrings = (t->nrings < TRACE_MAX_THREADS) ? t->nrings : TRACE_MAX_THREADS;
+
+        ringBase[f + 1] = ringBase[f] + nrings;
+
+        if (t->dropped > 0) {
+            fprintf(stderr, "pid %d: %u threads had no ring\n", t->pid, t->dropped);
+        }
+
+        for (r = 0; r < (int) nrings; r++) {
+            const struct trace_ring *ring = &t->rings[r];
+            uint64_t head = ring->head;
+            uint64_t first = (head > TRACE_RING_EVENTS) ? head - TRACE_RING_EVENTS : 0;
+
+            if (first > 0) {
+                fprintf(stderr, "pid %d tid %d: %llu oldest events overwritten\n",
+                        t->pid, ring->tid, (unsigned long long) first);
+            }
+
+            for (uint64_t e = first; e < head; e++) {
+                if (n == cap) {
+                    cap = cap ? 2 * cap : 4096;
+                    all = realloc(all, cap * sizeof(all[0]));
+
+                    if (all == NULL) {
+                        fprintf(stderr, "realloc error");
+                        exit(EXIT_FAILURE);
+                    }
+                }
+
+                all[n].ev = ring->ev[e & (TRACE_RING_EVENTS - 1)];
+                all[n].file = f;
+                all[n].ring = ringBase[f] + r;
+                n++;
+            }
+        }
+    }
+
+    if (n == 0) {
+        printf("No events\n");
+        exit(EXIT_SUCCESS);
+    }
+
+    qsort(all, n, sizeof(all[0]), cmpEvent);
+
+    /* Start time of the open span of each kind, per ring */
+    openNs = calloc((size_t) ringBase[nfiles] * MAX_SPANS, sizeof(openNs[0]));
+
+    if (openNs == NULL) {
+        fprintf(stderr, "calloc error");
+        exit(EXIT_FAILURE);
+    }
+
+    if (!summaryOnly) {
+        printf("%-18s %12s %7s %7s %-12s %10s %10s %10s %10s\n",
+               "time", "+usec", "pid", "tid", "event", "arg0", "arg1", "arg2", "span-usec");
+    }
+
+    for (size_t j = 0; j < n; j++) {
+        const struct loaded *l = &all[j];
+        const struct trace_file *t = files[l->file];
+        uint32_t id = l->ev.id;
+        unsigned k = (id - 1) / 2; /* Span kind of IDs 2k+1 and 2k+2 */
+        double span = -1;
+
+        if (id > 0 && k < MAX_SPANS) {
+            uint64_t *slot = &openNs[(size_t) l->ring * MAX_SPANS + k];
+
+            if (id & 1) {
+                *slot = l->ev.ns;
+            } else if (*slot != 0) {
+                if (lat[k] == NULL && (lat[k] = malloc(n * sizeof(uint64_t))) == NULL) {
+                    fprintf(stderr, "malloc error");
+                    exit(EXIT_FAILURE);
+                }
+
+                span = (l->ev.ns - *slot) / 1e3;
+                lat[k][nlat[k]++] = l->ev.ns - *slot;
+                *slot = 0;
+            }
+        }
+
+        if (!summaryOnly) {
+            uint64_t wall = t->realStart + (l->ev.ns - t->monoStart);
+            time_t sec = wall / 1000000000ULL;
+            char hms[16];
+
+            strftime(hms, sizeof(hms), "%T", localtime(&sec));
+            printf("%s.%09llu %12.3f %7d %7d %-12s %10d %10lld %10lld",
+                   hms, (unsigned long long) (wall % 1000000000ULL),
+                   (l->ev.ns - all[0].ev.ns) / 1e3, t->pid, t->rings[l->ring - ringBase[l->file]].tid,
+                   eventName(id), l->ev.arg0, (long long) l->ev.arg1, (long long) l->ev.arg2);
+
+            if (span >= 0) {
+                printf(" %10.3f", span);
+            }
+
+            printf("\n");
+        }
+    }
+
+    printf("\n%zu events from %d files\n", n, nfiles);
+    printf("%-12s %8s %10s %10s %10s %10s %10s  (usec)\n",
+           "span", "count", "min", "avg", "p50", "p99", "max");
+
+    for (r = 0; r < MAX_SPANS; r++) {
+        size_t c = nlat[r];
+        uint64_t *v = lat[r], sum = 0;
+
+        if (c == 0) {
+            continue;
+        }
+
+        qsort(v, c, sizeof(v[0]), cmpU64);
+
+        for (size_t j = 0; j < c; j++) {
+            sum += v[j];
+        }
+
+        printf("%-12s %8zu %10.3f %10.3f %10.3f %10.3f %10.3f\n", spanName(2 * r + 1), c,
+               v[0] / 1e3, sum / (double) c / 1e3, v[c / 2] / 1e3,
+               v[c * 99 / 100] / 1e3, v[c - 1] / 1e3);
+    }
+
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,152 @@
+/*
+ * Compile: gcc -O2 -o deadlock_demo deadlock_demo.c sem_owner.c
+ * Run: ./deadlock_demo [table-key] [rounds]
+ *      then in another terminal: ./deadlock_detect -k table-key
+ *
+ * 1. Cost of registering: ownReserve() + ownRelease() against plain semop().
+ * 2. Two children take semaphores 0 and 1 in opposite order, without
+ *    SEM_UNDO, and block on each other. Both are registered as locks, so
+ *    the detector reports the cycle and with -k kills one child and gives
+ *    back what it held; the other one finishes. The demo waits up to a
+ *    minute for that.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/sem.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "sem.h"
+#include "sem_owner.h"
+
+static double nowSec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void alarmHandler(int sig)
+{
+    /* Only interrupts waitpid() */
+}
+
+static void lockInOrder(struct own_table *t, int first, int second)
+{
+    if (ownReserve(t, first, 1, 0) == -1) {
+        _exit(EXIT_FAILURE);
+    }
+
+    printf("pid %ld holds sem %d, wants sem %d\n", (long) getpid(), first, second);
+    fflush(stdout);
+    sleep(1); /* Let the other child take its first semaphore */
+
+    if (ownReserve(t, second, 1, 0) == -1) {
+        _exit(EXIT_FAILURE);
+    }
+
+    printf("pid %ld got both\n", (long) getpid());
+    fflush(stdout);
+    ownRelease(t, second, 1, 0);
+    ownRelease(t, first, 1, 0);
+    _exit(EXIT_SUCCESS);
+}
+
+int main(int argc, char *argv[])
+{
+    key_t key = (argc > 1) ? (key_t) strtol(argv[1], NULL, 0) : 0x5e0d;
+    long rounds = (argc > 2) ? atol(argv[2]) : 1000000;
+    struct sembuf sop = { 0, 0, 0 };
+    struct own_table *t;
+    unsigned short init[2] = { 1, 1 };
+    union semun arg;
+    struct sigaction sa;
+    pid_t children[2];
+    int semid, status;
+    double start;
+
+    semid = semget(IPC_PRIVATE, 2, IPC_CREAT | S_IRUSR | S_IWUSR);
+    arg.array = init;
+
+    if (semid == -1 || semctl(semid, 0, SETALL, arg) == -1) {
+        fprintf(stderr, "semget error");
+        exit(EXIT_FAILURE);
+    }
+
+    if ((t = ownCreate(key, semid)) == NULL) {
+        fprintf(stderr, "ownCreate error");
+        semctl(semid, 0, IPC_RMID);
+        exit(EXIT_FAILURE);
+    }
+
+    if (ownSetLock(t, 0) == -1 || ownSetLock(t, 1) == -1) {
+        fprintf(stderr, "ownSetLock error");
+        semctl(semid, 0, IPC_RMID);
+        ownRemove(key, t);
+        exit(EXIT_FAILURE);
+    }
+
+    /* 1. Overhead */
+    start = nowSec();
+
+    for (long j = 0; j < rounds; j++) {
+        sop.sem_op = -1;
+        semop(semid, &sop, 1);
+        sop.sem_op = 1;
+        semop(semid, &sop, 1);
+    }
+
+    printf("semop() pair                 %7.1f ns\n", (nowSec() - start) / rounds * 1e9);
+    start = nowSec();
+
+    for (long j = 0; j < rounds; j++) {
+        ownReserve(t, 0, 1, 0);
+        ownRelease(t, 0, 1, 0);
+    }
+
+    printf("ownReserve() + ownRelease()  %7.1f ns\n\n", (nowSec() - start) / rounds * 1e9);
+
+    /* 2. Lock-order deadlock */
+    printf("table key 0x%lx, set %d: run ./deadlock_detect -k 0x%lx\n",
+           (long) key, semid, (long) key);
+    fflush(stdout);
+
+    for (int j = 0; j < 2; j++) {
+        switch (children[j] = fork()) {
+        case -1:
+            fprintf(stderr, "fork error");
+            exit(EXIT_FAILURE);
+
+        case 0:
+            lockInOrder(t, j, !j);
+        }
+    }
+
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = 0; /* No SA_RESTART, the alarm must end waitpid() */
+    sa.sa_handler = alarmHandler;
+    sigaction(SIGALRM, &sa, NULL);
+    alarm(60);
+
+    for (int j = 0; j < 2; j++) {
+        pid_t pid = waitpid(-1, &status, 0);
+
+        if (pid == -1) {
+            printf("still deadlocked after 60 s, killing both\n");
+            kill(children[0], SIGKILL);
+            kill(children[1], SIGKILL);
+            break;
+        }
+
+        printf("child %ld %s\n", (long) pid,
+               WIFSIGNALED(status) ? "was killed" : "finished");
+    }
+
+    semctl(semid, 0, IPC_RMID);
+    ownRemove(key, t);
+    exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,324 @@
+/*
+ * Compile: gcc -o deadlock_detect deadlock_detect.c sem_owner.c
+ * Run: ./deadlock_detect [-i interval-ms] [-k] table-key
+ *
+ * Watches the ownership table (sem_owner.h) of a semaphore set. Every
+ * interval it copies the table and draws an edge from each blocked process
+ * to every process holding units of the semaphore it waits for. A wait only
+ * counts when the same wait (same waitSeq) is seen in two samples in a row
+ * and the kernel agrees someone is blocked there (GETNCNT > 0), so the
+ * short waits of normal traffic never show up. Cycles in that graph are
+ * deadlocks and are reported once each.
+ *
+ * A waiter with no registered holder is reported with the set's GETPID,
+ * the last process that changed the semaphore, as the best guess.
+ *
+ * -k breaks cycles: the member holding the fewest units gets SIGTERM. Units
+ * that a dead process held without SEM_UNDO are given back to the set on
+ * the next sample if the semaphore is a lock (ownSetLock()); on any other
+ * semaphore, and without -k, they are only reported.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/sem.h>
+#include "sem.h"
+#include "sem_owner.h"
+
+struct wait_state { /* Previous sample, per slot */
+    pid_t pid;
+    int waitSem;
+    unsigned waitSeq;
+    int reported; /* This wait was already reported */
+};
+
+static struct own_table snap;
+static struct wait_state prev[OWN_MAX_PROCS];
+static char adj[OWN_MAX_PROCS][OWN_MAX_PROCS]; /* adj[i][j]: i waits for j */
+static int color[OWN_MAX_PROCS], parent[OWN_MAX_PROCS];
+static int breakCycles;
+
+static void stamp(void)
+{
+    char buf[16];
+    time_t t = time(NULL);
+
+    strftime(buf, sizeof(buf), "%T", localtime(&t));
+    printf("%s ", buf);
+}
+
+static int isGone(pid_t pid) /* Dead, or a zombie nobody has reaped yet */
+{
+    char path[64], state = 0;
+    FILE *f;
+
+    if (kill(pid, 0) == -1 && errno == ESRCH) {
+        return 1;
+    }
+
+    snprintf(path, sizeof(path), "/proc/%ld/stat", (long) pid);
+
+    if ((f = fopen(path, "r")) == NULL) {
+        return 0;
+    }
+
+    fscanf(f, "%*d (%*[^)]) %c", &state); /* Assumes no ')' in the name */
+    fclose(f);
+    return state == 'Z';
+}
+
+static int heldUnits(const struct own_slot *s)
+{
+    int n = 0;
+
+    for (int j = 0; j < OWN_MAX_SEMS; j++) {
+        n += s->held[j];
+    }
+
+    return n;
+}
+
+static int lostUnits(const struct own_slot *s, int semNum) /* Held without SEM_UNDO */
+{
+    int n = s->held[semNum] - s->heldUndo[semNum];
+
+    return (n > 0) ? n : 0;
+}
+
+/* Free the slot of a dead process; with -k give back what it held of locks
+   without SEM_UNDO (the kernel already returned the rest). Units of other
+   semaphores may have been consumed, giving them back would invent some. */
+static void reapDead(struct own_table *t, int i)
+{
+    struct own_slot *s = &snap.slots[i];
+    pid_t old = s->pid;
+    int units = heldUnits(s), lost = 0;
+
+    /* Lose the race to a process reusing the slot and it is theirs */
+    if (!__atomic_compare_exchange_n(&t->slots[i].pid, &old, 0, 0,
+                                     __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        return;
+    }
+
+    if (units == 0) {
+        return;
+    }
+
+    for (int j = 0; j < snap.nsems; j++) {
+        lost += lostUnits(s, j);
+    }
+
+    stamp();
+
+    if (lost == 0) {
+        printf("pid %ld died holding %d units, SEM_UNDO gave them back\n", (long) s->pid, units);
+        return;
+    }
+
+    printf("pid %ld died holding %d units, %d without SEM_UNDO:", (long) s->pid, units, lost);
+
+    for (int j = 0; j < snap.nsems; j++) {
+        struct sembuf sop = { j, lostUnits(s, j), 0 };
+
+        if (sop.sem_op == 0) {
+            continue;
+        }
+
+        printf(" sem %d x%d", j, sop.sem_op);
+
+        if (!breakCycles || !snap.isLock[j]) {
+            printf(" (lost)");
+        } else {
+            printf(semop(snap.semId, &sop, 1) == -1 ? " (release failed)" : " (released)");
+        }
+    }
+
+    printf("\n");
+}
+
+static void reportCycle(int from, int to) /* Back edge from -> to closes a cycle */
+{
+    int cycle[OWN_MAX_PROCS], len = 0, fresh = 0, victim = -1, best = 0;
+
+    /* The tree path to ... from, in the order the edges point */
+    for (int v = from; ; v = parent[v]) {
+        cycle[len++] = v;
+        fresh |= !prev[v].reported;
+
+        if (v == to) {
+            break;
+        }
+    }
+
+    if (!fresh) {
+        return; /* Same deadlock as last sample */
+    }
+
+    stamp();
+    printf("deadlock:\n");
+
+    for (int k = len - 1; k >= 0; k--) {
+        struct own_slot *s = &snap.slots[cycle[k]];
+        int units = heldUnits(s);
+
+        prev[cycle[k]].reported = 1;
+        printf("         pid %ld waits for sem %d held by pid %ld\n", (long) s->pid, s->waitSem,
+               (long) snap.slots[cycle[k > 0 ? k - 1 : len - 1]].pid);
+
+        if (victim == -1 || units < best || (units == best && s->pid > snap.slots[victim].pid)) {
+            victim = cycle[k];
+            best = units;
+        }
+    }
+
+    if (breakCycles) {
+        printf("         killing pid %ld (holds %d units)\n", (long) snap.slots[victim].pid, best);
+        kill(snap.slots[victim].pid, SIGTERM);
+    }
+}
+
+static void dfs(int v)
+{
+    color[v] = 1; /* On the stack */
+
+    for (int w = 0; w < OWN_MAX_PROCS; w++) {
+        if (!adj[v][w]) {
+            continue;
+        }
+
+        if (color[w] == 0) {
+            parent[w] = v;
+            dfs(w);
+        } else if (color[w] == 1) {
+            reportCycle(v, w);
+        }
+    }
+
+    color[v] = 2;
+}
+
+static void sample(struct own_table *t)
+{
+    int stable[OWN_MAX_PROCS], ncnt[OWN_MAX_SEMS];
+
+    memcpy(&snap, t, sizeof(snap));
+    memset(adj, 0, sizeof(adj));
+
+    for (int j = 0; j < snap.nsems; j++) {
+        ncnt[j] = -1; /* Queried on demand */
+    }
+
+    for (int i = 0; i < OWN_MAX_PROCS; i++) {
+        struct own_slot *s = &snap.slots[i];
+        int w = s->waitSem;
+
+        stable[i] = 0;
+
+        if (s->pid == 0) {
+            prev[i].pid = 0;
+            continue;
+        }
+
+        if (isGone(s->pid)) {
+            reapDead(t, i);
+            prev[i].pid = 0;
+            continue;
+        }
+
+        if (w >= 0 && w < snap.nsems && s->pid == prev[i].pid && w == prev[i].waitSem
+                && s->waitSeq == prev[i].waitSeq) {
+            if (ncnt[w] == -1) {
+                ncnt[w] = semctl(snap.semId, w, GETNCNT);
+            }
+
+            stable[i] = ncnt[w] > 0;
+        } else {
+            prev[i].reported = 0;
+        }
+
+        prev[i].pid = s->pid;
+        prev[i].waitSem = w;
+        prev[i].waitSeq = s->waitSeq;
+    }
+
+    for (int i = 0; i < OWN_MAX_PROCS; i++) {
+        int w = snap.slots[i].waitSem, holders = 0;
+
+        if (!stable[i]) {
+            continue;
+        }
+
+        for (int j = 0; j < OWN_MAX_PROCS; j++) {
+            if (j != i && prev[j].pid != 0 && snap.slots[j].held[w] > 0) {
+                adj[i][j] = 1;
+                holders++;
+            }
+        }
+
+        if (holders == 0 && !prev[i].reported) {
+            stamp();
+            printf("pid %ld blocked on sem %d with no registered holder, last semop by pid %d\n",
+                   (long) snap.slots[i].pid, w, semctl(snap.semId, w, GETPID));
+            prev[i].reported = 1;
+        }
+    }
+
+    memset(color, 0, sizeof(color));
+
+    for (int i = 0; i < OWN_MAX_PROCS; i++) {
+        if (color[i] == 0) {
+            dfs(i);
+        }
+    }
+
+    fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+    struct own_table *t;
+    long intervalMs = 500;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "i:k")) != -1) {
+        switch (opt) {
+        case 'i': intervalMs = atol(optarg); break;
+        case 'k': breakCycles = 1; break;
+
+        default:
+            fprintf(stderr, "Usage: %s [-i interval-ms] [-k] table-key\n", argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (optind >= argc) {
+        fprintf(stderr, "Usage: %s [-i interval-ms] [-k] table-key\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    if ((t = ownOpen((key_t) strtol(argv[optind], NULL, 0))) == NULL) {
+        fprintf(stderr, "ownOpen error");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("watching semaphore set %d (%d semaphores), every %ld ms%s\n",
+           t->semId, t->nsems, intervalMs, breakCycles ? ", breaking cycles" : "");
+    fflush(stdout);
+
+    for (;;) {
+        if (semctl(t->semId, 0, GETNCNT) == -1 && (errno == EINVAL || errno == EIDRM)) {
+            printf("semaphore set removed\n");
+            break;
+        }
+
+        sample(t);
+        usleep(intervalMs * 1000);
+    }
+
+    exit(EXIT_SUCCESS);
+}
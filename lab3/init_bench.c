@@ -0,0 +1,175 @@
+/*
+ * Compile: gcc -O2 -o init_bench init_bench.c sem_init.c
+ * Run: ./init_bench [processes] [init-usec]
+ *
+ * Cold start of a fleet: all processes start together, one creates the set
+ * and spends init-usec initializing it, the rest must wait until it is
+ * safe to use. Reports how long each process took to get there with
+ *   poll  - the sem_good_init loop: check sem_otime, sleep(1), retry
+ *   gate  - semInitOnce(): block in semop() until the creator opens the gate
+ *   crash - gate, but the first initializer dies halfway through
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/sem.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "sem.h"
+#include "sem_init.h"
+
+#define BENCH_KEY 0x15b0
+#define MAX_TRIES 10
+
+static long initUsec;
+static int *initCount; /* Shared: initializers started so far */
+
+static double nowSec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int slowInit(int semid, int nsems, void *arg)
+{
+	int crash = *(int *) arg;
+	union semun val;
+
+	usleep(initUsec / 2);
+
+	if (crash && __atomic_fetch_add(initCount, 1, __ATOMIC_SEQ_CST) == 0) {
+		_exit(EXIT_SUCCESS); /* Dies holding the owner semaphore */
+	}
+
+	usleep(initUsec / 2);
+	val.val = 0;
+	return semctl(semid, 0, SETVAL, val);
+}
+
+static int pollJoin(void) /* Same steps as the old sem_good_init */
+{
+	struct semid_ds ds;
+	struct sembuf sop = { 0, 0, 0 };
+	union semun arg;
+	int semid = semget(BENCH_KEY, 1, IPC_CREAT | IPC_EXCL | S_IRUSR | S_IWUSR);
+
+	if (semid != -1) {
+		usleep(initUsec);
+		arg.val = 0;
+
+		if (semctl(semid, 0, SETVAL, arg) == -1 || semop(semid, &sop, 1) == -1) {
+			return -1;
+		}
+
+		return 0;
+	}
+
+	if (errno != EEXIST || (semid = semget(BENCH_KEY, 1, S_IRUSR | S_IWUSR)) == -1) {
+		return -1;
+	}
+
+	arg.buf = &ds;
+
+	for (int j = 0; j < MAX_TRIES; j++) {
+		if (semctl(semid, 0, IPC_STAT, arg) == -1) {
+			return -1;
+		}
+
+		if (ds.sem_otime != 0) {
+			return 0;
+		}
+
+		sleep(1);
+	}
+
+	return -1;
+}
+
+static void run(const char *name, int procs, int mode)
+{
+	int go[2], res[2], crash = (mode == 2), created, semid, ok = 0;
+	double start, end, sum = 0, max = 0;
+	union semun dummy;
+
+	if (pipe(go) == -1 || pipe(res) == -1) {
+		fprintf(stderr, "pipe error");
+		exit(EXIT_FAILURE);
+	}
+
+	*initCount = 0;
+
+	for (int j = 0; j < procs; j++) {
+		switch (fork()) {
+		case -1:
+			fprintf(stderr, "fork error");
+			exit(EXIT_FAILURE);
+
+		case 0:
+			close(go[1]);
+			read(go[0], &start, 1); /* Returns at EOF: everyone starts together */
+
+			if (mode == 0) {
+				semid = pollJoin();
+			} else {
+				semid = semInitOnce(BENCH_KEY, 1, S_IRUSR | S_IWUSR, slowInit, &crash, &created);
+			}
+
+			if (semid != -1) {
+				end = nowSec();
+				write(res[1], &end, sizeof(end));
+			}
+
+			_exit(EXIT_SUCCESS);
+		}
+	}
+
+	close(go[0]);
+	close(res[1]);
+	start = nowSec();
+	close(go[1]);
+
+	while (read(res[0], &end, sizeof(end)) == sizeof(end)) {
+		sum += end - start;
+		max = (end - start > max) ? end - start : max;
+		ok++;
+	}
+
+	while (wait(NULL) > 0) {
+		continue;
+	}
+
+	close(res[0]);
+	printf("%-6s %5d/%-5d %12.0f %12.0f\n", name, ok, procs,
+		ok ? sum / ok * 1e6 : 0.0, max * 1e6);
+
+	semctl(semget(BENCH_KEY, 0, 0), 0, IPC_RMID, dummy);
+}
+
+int main(int argc, char *argv[])
+{
+	int procs = (argc > 1) ? atoi(argv[1]) : 16;
+	union semun dummy;
+
+	initUsec = (argc > 2) ? atol(argv[2]) : 2000;
+	initCount = mmap(NULL, sizeof(int), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+	if (initCount == MAP_FAILED) {
+		fprintf(stderr, "mmap error");
+		exit(EXIT_FAILURE);
+	}
+
+	semctl(semget(BENCH_KEY, 0, 0), 0, IPC_RMID, dummy); /* Leftover from a killed run */
+
+	printf("mode   ready/procs  avg-usec     max-usec\n");
+	run("poll", procs, 0);
+	run("gate", procs, 1);
+	run("crash", procs, 2);
+
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,106 @@
+#define _GNU_SOURCE /* semtimedop() */
+#include <errno.h>
+#include <time.h>
+#include <sys/sem.h>
+#include "sem_init.h"
+
+/* Become the initializer, only if the set is not ready and nobody else is
+   initializing it. The owner count carries SEM_UNDO, so a crash releases it. */
+static int claimOwner(int semid, int nsems)
+{
+    struct sembuf sops[3] = {
+        { INIT_GATE(nsems), 0, IPC_NOWAIT },
+        { INIT_OWNER(nsems), 0, IPC_NOWAIT },
+        { INIT_OWNER(nsems), 1, SEM_UNDO | IPC_NOWAIT }
+    };
+
+    return semop(semid, sops, 3); /* EAGAIN: ready or owned by someone */
+}
+
+static int publish(int semid, int nsems, sem_init_fn init, void *arg)
+{
+    struct sembuf sops[2] = {
+        { INIT_GATE(nsems), 1, 0 }, /* No SEM_UNDO, stays open after we exit */
+        { INIT_OWNER(nsems), -1, SEM_UNDO }
+    };
+
+    if (init != NULL && init(semid, nsems, arg) == -1) {
+        int savedErrno = errno;
+
+        semop(semid, &sops[1], 1); /* Let a waiter take over */
+        errno = savedErrno;
+        return -1;
+    }
+
+    /* Opening the gate wakes every blocked waiter in one operation */
+    return semop(semid, sops, 2);
+}
+
+/* Returns 0 once the gate is open, 1 if the owner died and we took over */
+static int waitReady(int semid, int nsems)
+{
+    struct sembuf sops[2] = {
+        { INIT_GATE(nsems), -1, 0 }, /* Block until the gate is open ... */
+        { INIT_GATE(nsems), 1, 0 } /* ... and leave it open */
+    };
+    struct timespec check = { INIT_CHECK_MS / 1000, (INIT_CHECK_MS % 1000) * 1000000L };
+
+    for (;;) {
+        if (semtimedop(semid, sops, 2, &check) == 0) {
+            return 0;
+        }
+
+        if (errno == EINTR) {
+            continue;
+        }
+
+        if (errno != EAGAIN) {
+            return -1;
+        }
+
+        /* Still closed after INIT_CHECK_MS: is anyone initializing? */
+        if (claimOwner(semid, nsems) == 0) {
+            return 1;
+        }
+
+        if (errno != EAGAIN) {
+            return -1;
+        }
+    }
+}
+
+int semInitOnce(key_t key, int nsems, int perms, sem_init_fn init, void *arg, int *created)
+{
+    int semid, s;
+
+    *created = 0;
+    semid = semget(key, nsems + INIT_CTL_SEMS, IPC_CREAT | IPC_EXCL | perms);
+
+    if (semid != -1) {
+        /* New set: everything is 0, so the claim only fails if a waiter
+           already decided we were dead and took over */
+        if (claimOwner(semid, nsems) == 0) {
+            *created = 1;
+            return (publish(semid, nsems, init, arg) == -1) ? -1 : semid;
+        }
+    } else {
+        if (errno != EEXIST) {
+            return -1;
+        }
+
+        semid = semget(key, nsems + INIT_CTL_SEMS, perms);
+
+        if (semid == -1) {
+            return -1;
+        }
+    }
+
+    s = waitReady(semid, nsems);
+
+    if (s == 1) {
+        *created = 1;
+        return (publish(semid, nsems, init, arg) == -1) ? -1 : semid;
+    }
+
+    return (s == -1) ? -1 : semid;
+}
@@ -0,0 +1,25 @@
+#ifndef SEM_INIT_H
+#define SEM_INIT_H /* Prevent accidental double inclusion */
+#include <sys/types.h>
+
+/* Initialization handshake for a shared semaphore set, without polling
+   sem_otime. Two control semaphores follow the caller's nsems:
+     INIT_GATE(nsems)  - 0 until the set is initialized, then 1 for good;
+                         waiters block on it with semop()
+     INIT_OWNER(nsems) - 1 while someone is initializing, held with
+                         SEM_UNDO so it drops back to 0 if that process dies
+   A waiter that finds the gate closed and no owner takes over the init. */
+#define INIT_CTL_SEMS 2
+#define INIT_GATE(nsems) (nsems)
+#define INIT_OWNER(nsems) ((nsems) + 1)
+#define INIT_CHECK_MS 100 /* How often waiters check the owner is alive */
+
+/* Sets up the caller's semaphores, e.g. SETVAL on each of them. Must not use
+   SETALL, that would clear the owner's SEM_UNDO adjustment. */
+typedef int (*sem_init_fn)(int semid, int nsems, void *arg);
+
+/* Returns the semid of an initialized set, *created tells whether this
+   process ran 'init' (first creator or takeover). */
+int semInitOnce(key_t key, int nsems, int perms, sem_init_fn init, void *arg, int *created);
+
+#endif
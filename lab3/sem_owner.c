@@ -0,0 +1,244 @@
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/sem.h>
+#include <sys/shm.h>
+#include <sys/stat.h>
+#include "sem.h"
+#include "sem_owner.h"
+
+static struct own_slot *mySlot; /* Our slot, dropped in a fork() child */
+static int atforkSet;
+
+static void forgetSlot(void)
+{
+    mySlot = NULL;
+}
+
+struct own_table *ownCreate(key_t key, int semId)
+{
+    struct semid_ds ds;
+    struct own_table *t;
+    union semun arg;
+    int shmid;
+
+    arg.buf = &ds;
+
+    if (semctl(semId, 0, IPC_STAT, arg) == -1) {
+        return NULL;
+    }
+
+    if (ds.sem_nsems > OWN_MAX_SEMS) {
+        errno = E2BIG;
+        return NULL;
+    }
+
+    shmid = shmget(key, sizeof(*t), IPC_CREAT | IPC_EXCL | S_IRUSR | S_IWUSR);
+
+    if (shmid == -1 || (t = shmat(shmid, NULL, 0)) == (void *) -1) {
+        return NULL;
+    }
+
+    t->semId = semId; /* Fresh segment, the slots are already zero */
+    t->nsems = ds.sem_nsems;
+    return t;
+}
+
+struct own_table *ownOpen(key_t key)
+{
+    struct own_table *t;
+    int shmid = shmget(key, 0, 0);
+
+    if (shmid == -1 || (t = shmat(shmid, NULL, 0)) == (void *) -1) {
+        return NULL;
+    }
+
+    return t;
+}
+
+int ownRemove(key_t key, struct own_table *t)
+{
+    int shmid = shmget(key, 0, 0);
+
+    if (shmid == -1 || shmdt(t) == -1) {
+        return -1;
+    }
+
+    return shmctl(shmid, IPC_RMID, NULL);
+}
+
+int ownSetLock(struct own_table *t, int semNum)
+{
+    if (semNum < 0 || semNum >= t->nsems) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    __atomic_store_n(&t->isLock[semNum], 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+static struct own_slot *join(struct own_table *t)
+{
+    pid_t self;
+
+    if (mySlot != NULL) {
+        return mySlot; /* No getpid() on the fast path */
+    }
+
+    if (!atforkSet) {
+        pthread_atfork(NULL, NULL, forgetSlot);
+        atforkSet = 1;
+    }
+
+    self = getpid();
+
+    /* Free slots first, then those left behind by dead processes */
+    for (int pass = 0; pass < 2; pass++) {
+        for (int j = 0; j < OWN_MAX_PROCS; j++) {
+            struct own_slot *s = &t->slots[j];
+            pid_t old = __atomic_load_n(&s->pid, __ATOMIC_ACQUIRE);
+
+            if (pass == 0 ? old != 0 : (old == 0 || kill(old, 0) == 0 || errno != ESRCH)) {
+                continue;
+            }
+
+            if (__atomic_compare_exchange_n(&s->pid, &old, self, 0,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+                memset(s->held, 0, sizeof(s->held));
+                memset(s->heldUndo, 0, sizeof(s->heldUndo));
+                /* posted[] stays: signals of the dead process still wait for a taker */
+                __atomic_store_n(&s->waitSem, -1, __ATOMIC_RELEASE);
+                mySlot = s;
+                return s;
+            }
+        }
+    }
+
+    errno = ENOSPC;
+    return NULL;
+}
+
+/* Take up to n units off the posted[semNum] of the slots, returns how many */
+static int takePosted(struct own_table *t, int semNum, int n)
+{
+    int taken = 0;
+
+    for (int j = 0; j < OWN_MAX_PROCS && taken < n; j++) {
+        unsigned short *p = &t->slots[j].posted[semNum];
+        unsigned short cur = __atomic_load_n(p, __ATOMIC_ACQUIRE);
+        int k;
+
+        do {
+            if (cur == 0) {
+                break;
+            }
+
+            k = (cur < n - taken) ? cur : n - taken;
+        } while (!__atomic_compare_exchange_n(p, &cur, cur - k, 0,
+                                              __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+        if (cur != 0) {
+            taken += k;
+        }
+    }
+
+    return taken;
+}
+
+int ownReserve(struct own_table *t, int semNum, int n, int flags)
+{
+    struct sembuf sop = { semNum, -n, flags };
+    struct own_slot *s = join(t);
+    int r;
+
+    if (s == NULL) {
+        return -1;
+    }
+
+    if (semNum < 0 || semNum >= t->nsems || n <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /* Announce the wait before we may block; seq first so the detector
+       never pairs a new wait with an old sequence number */
+    __atomic_add_fetch(&s->waitSeq, 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&s->waitSem, semNum, __ATOMIC_RELEASE);
+
+    while ((r = semop(t->semId, &sop, 1)) == -1 && errno == EINTR) {
+        continue;
+    }
+
+    /* Units a non-holder posted are a signal, not ownership; a lock is
+       always owned. heldUndo first: a release computing held - heldUndo in
+       between sees too few units it may drop, never too many. */
+    if (r == 0 && !__atomic_load_n(&t->isLock[semNum], __ATOMIC_ACQUIRE)) {
+        n -= takePosted(t, semNum, n);
+    }
+
+    if (r == 0 && n > 0) {
+        if (flags & SEM_UNDO) {
+            __atomic_add_fetch(&s->heldUndo[semNum], n, __ATOMIC_RELAXED);
+        }
+
+        __atomic_add_fetch(&s->held[semNum], n, __ATOMIC_RELEASE);
+    }
+
+    __atomic_store_n(&s->waitSem, -1, __ATOMIC_RELEASE);
+    return r;
+}
+
+int ownRelease(struct own_table *t, int semNum, int n, int flags)
+{
+    struct sembuf sop = { semNum, n, flags };
+    struct own_slot *s = join(t);
+    int own;
+
+    if (s == NULL) {
+        return -1;
+    }
+
+    if (semNum < 0 || semNum >= t->nsems || n <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /* Drop ownership first: a stale "held" could show a cycle that is not
+       there, a missing one only delays a report by one sample. Only our own
+       units of the SEM_UNDO class 'flags' names; held[] before heldUndo[]
+       so the non-SEM_UNDO part never looks larger than it is. */
+    if (flags & SEM_UNDO) {
+        own = __atomic_load_n(&s->heldUndo[semNum], __ATOMIC_RELAXED);
+    } else {
+        own = __atomic_load_n(&s->held[semNum], __ATOMIC_RELAXED)
+            - __atomic_load_n(&s->heldUndo[semNum], __ATOMIC_RELAXED);
+    }
+
+    own = (own < n) ? own : n;
+    __atomic_sub_fetch(&s->held[semNum], own, __ATOMIC_RELEASE);
+
+    if (flags & SEM_UNDO) {
+        __atomic_sub_fetch(&s->heldUndo[semNum], own, __ATOMIC_RELEASE);
+    }
+
+    if (semop(t->semId, &sop, 1) == -1) {
+        if (flags & SEM_UNDO) {
+            __atomic_add_fetch(&s->heldUndo[semNum], own, __ATOMIC_RELAXED);
+        }
+
+        __atomic_add_fetch(&s->held[semNum], own, __ATOMIC_RELEASE);
+        return -1;
+    }
+
+    /* The rest is a signal, e.g. a writer handing the turn to a reader:
+       leave it in our own posted[] for the next reserve to find. Other
+       slots are never touched, their held[] stays theirs to drop. */
+    if (own < n && !__atomic_load_n(&t->isLock[semNum], __ATOMIC_ACQUIRE)) {
+        __atomic_add_fetch(&s->posted[semNum], n - own, __ATOMIC_RELEASE);
+    }
+
+    return 0;
+}
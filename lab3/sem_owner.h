@@ -0,0 +1,54 @@
+#ifndef SEM_OWNER_H
+#define SEM_OWNER_H /* Prevent accidental double inclusion */
+#include <sys/types.h>
+
+/* Ownership registry for one semaphore set, kept in a shared memory segment
+   next to it. Every process that takes semaphores through ownReserve() gets
+   a slot and is the only writer of its held[] and wait fields: the units it
+   holds per semaphore and the semaphore it is blocked on, if any. Other
+   processes only take units off its posted[], atomically. Registering
+   costs a few atomic stores around each semop(), so it can stay on in
+   production. The detector (deadlock_detect.c) reads the slots to build a
+   wait-for graph. */
+#define OWN_MAX_PROCS 64
+#define OWN_MAX_SEMS 256
+
+struct own_slot {
+    pid_t pid; /* 0 = free */
+    int waitSem; /* Semaphore we are blocked on, -1 = none */
+    unsigned waitSeq; /* Bumped on every wait, tells a new wait from a long one */
+    unsigned short held[OWN_MAX_SEMS]; /* Units held per semaphore */
+    unsigned short heldUndo[OWN_MAX_SEMS]; /* Part of held[] taken with SEM_UNDO */
+    unsigned short posted[OWN_MAX_SEMS]; /* Released beyond what we held, not yet taken */
+};
+
+struct own_table {
+    int semId;
+    int nsems;
+    unsigned char isLock[OWN_MAX_SEMS]; /* Set by ownSetLock() */
+    struct own_slot slots[OWN_MAX_PROCS];
+};
+
+/* Creates the segment for 'key' (fails with EEXIST if it is there) */
+struct own_table *ownCreate(key_t key, int semId);
+struct own_table *ownOpen(key_t key);
+int ownRemove(key_t key, struct own_table *t);
+
+/* Marks semNum as a lock: whoever takes a unit gives it back. Call it before
+   the semaphore is used. Only for locks does deadlock_detect -k return the
+   units of a process that died holding them without SEM_UNDO; on other
+   semaphores (items, hand-off tokens) those units may have been consumed. */
+int ownSetLock(struct own_table *t, int semNum);
+
+/* semop() of -n / +n on semNum with 'flags', recorded in our slot. The slot
+   is claimed on first use, also after fork(); slots of dead processes are
+   reused. A release drops only what this process holds itself (with or
+   without SEM_UNDO, matching 'flags') and adjusts the semaphore by n either
+   way. On a semaphore that is not a lock the rest is a signal, as when a
+   writer hands a turn to a reader: it goes to our slot's posted[], and a
+   reserve there counts units it finds posted by anyone as received rather
+   than held. On a lock the rest is not recorded. */
+int ownReserve(struct own_table *t, int semNum, int n, int flags);
+int ownRelease(struct own_table *t, int semNum, int n, int flags);
+
+#endif
@@ -0,0 +1,127 @@
+#include <sys/types.h>
+#include <sys/sem.h>
+#include <errno.h>
+#include "semun.h"
+#include "binary_sems.h" /* futexWait(), futexWake() */
+#include "barrier.h"
+
+int barrierSemOpen(struct barrier *b, int semId, int base, int n)
+{
+	if (n < 1) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	b->backend = BARRIER_SEM;
+	b->n = n;
+	b->phase = 0;
+	b->semId = semId;
+	b->base = base;
+	b->sh = NULL;
+	return 0;
+}
+
+int barrierSemInit(struct barrier *b, int semId, int base, int n)
+{
+	union semun arg;
+
+	if (barrierSemOpen(b, semId, base, n) == -1) {
+		return -1;
+	}
+
+	for (int j = 0; j < BARRIER_NSEMS; j++) {
+		arg.val = (j == 0) ? n : 0; /* Only round 1 armed */
+
+		if (semctl(semId, base + j, SETVAL, arg) == -1) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+int barrierFutexOpen(struct barrier *b, struct barrier_shared *sh, int n)
+{
+	if (n < 1) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	b->backend = BARRIER_FUTEX;
+	b->n = n;
+	b->phase = 0;
+	b->sh = sh;
+	return 0;
+}
+
+int barrierFutexInit(struct barrier *b, struct barrier_shared *sh, int n)
+{
+	if (barrierFutexOpen(b, sh, n) == -1) {
+		return -1;
+	}
+
+	sh->count = n;
+	__atomic_store_n(&sh->phase, 0, __ATOMIC_SEQ_CST);
+	return 0;
+}
+
+static int semWait(struct barrier *b)
+{
+	struct sembuf sops[2];
+	int p = b->phase, next = (p + 1) % BARRIER_NSEMS;
+
+	/* Arrive: one less missing in this round, one more armed in the next */
+	sops[0].sem_num = b->base + p;
+	sops[0].sem_op = -1;
+	sops[0].sem_flg = 0;
+	sops[1].sem_num = b->base + next;
+	sops[1].sem_op = 1;
+	sops[1].sem_flg = 0;
+
+	if (semop(b->semId, sops, 2) == -1) {
+		return -1;
+	}
+
+	/* Leave when everyone has arrived. Nobody can re-arm this count before
+	   we are through, see barrier.h. */
+	sops[0].sem_op = 0;
+
+	while (semop(b->semId, sops, 1) == -1) {
+		if (errno != EINTR) {
+			return -1;
+		}
+	}
+
+	b->phase = next;
+	return 0;
+}
+
+static int futexBarrierWait(struct barrier *b)
+{
+	struct barrier_shared *sh = b->sh;
+	int next = !b->phase;
+
+	b->phase = next;
+
+	if (__atomic_sub_fetch(&sh->count, 1, __ATOMIC_ACQ_REL) == 0) {
+		/* Last one in: re-arm before releasing, nobody touches count
+		   until they have seen the new phase */
+		__atomic_store_n(&sh->count, b->n, __ATOMIC_RELAXED);
+		__atomic_store_n(&sh->phase, next, __ATOMIC_RELEASE);
+		futexWake(&sh->phase, __INT_MAX__);
+		return 0;
+	}
+
+	while (__atomic_load_n(&sh->phase, __ATOMIC_ACQUIRE) != next) {
+		if (futexWait(&sh->phase, !next, NULL) == -1 && errno != EAGAIN && errno != EINTR) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+int barrierWait(struct barrier *b)
+{
+	return (b->backend == BARRIER_SEM) ? semWait(b) : futexBarrierWait(b);
+}
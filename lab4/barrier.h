@@ -0,0 +1,43 @@
+#ifndef BARRIER_H /* Prevent accidental double inclusion */
+#define BARRIER_H
+
+/* Reusable N-process barrier. Each process keeps its own copy of struct
+   barrier (fork() after init, or Open in unrelated processes); only the
+   counters are shared. Both backends are sense-reversing: rounds
+   alternate between phases, so a fast process entering round k+1
+   cannot disturb one still leaving round k.
+
+   System V: three semaphores from 'base', round r uses number r % 3. Its
+   count goes down to 0 as processes arrive, each arrival also adds 1 to
+   the semaphore of round r + 1 so it is armed with N, then the process
+   waits for zero. Two semaphores are not enough: a process released from
+   round r could arm the count that a slower one is only now going to
+   wait on for zero. With three, that count is next armed in round r + 2,
+   which nobody reaches before every process has left round r.
+   Futex: a shared counter and a phase word; the last arrival resets the
+   counter, flips the phase and wakes everyone sleeping on it. */
+#define BARRIER_NSEMS 3
+
+enum barrier_backend { BARRIER_SEM, BARRIER_FUTEX };
+
+struct barrier_shared { /* Futex backend, in shared memory */
+	int count; /* Arrivals still missing this round */
+	int phase; /* Flipped by the last arrival */
+};
+
+struct barrier {
+	enum barrier_backend backend;
+	int n;
+	int phase; /* This process's current phase */
+	int semId, base;
+	struct barrier_shared *sh;
+};
+
+int barrierSemInit(struct barrier *b, int semId, int base, int n); /* Once per set */
+int barrierSemOpen(struct barrier *b, int semId, int base, int n); /* Before round 1 */
+int barrierFutexInit(struct barrier *b, struct barrier_shared *sh, int n);
+int barrierFutexOpen(struct barrier *b, struct barrier_shared *sh, int n); /* Before round 1 */
+
+int barrierWait(struct barrier *b);
+
+#endif
@@ -0,0 +1,131 @@
+/*
+ * Compile: gcc -O2 -o barrier_bench barrier_bench.c barrier.c binary_sems.c
+ * Run: ./barrier_bench [rounds] [max-processes]
+ *
+ * N processes go through the same barrier 'rounds' times; the time per
+ * round is the barrier latency. Runs N = 2, 4, ... max-processes (64 by
+ * default) with the System V and the futex backend. Every process checks
+ * after each round that nobody is a round ahead or behind.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/sem.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "barrier.h"
+
+#define MAX_PROCS 1024
+
+struct bench_shared {
+	struct barrier_shared bs;
+	long round[MAX_PROCS]; /* Round each process has completed */
+	int errors;
+};
+
+static double nowSec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double run(struct bench_shared *sh, int semid, enum barrier_backend backend,
+		int procs, long rounds)
+{
+	struct barrier b;
+	double start;
+	int s;
+
+	s = (backend == BARRIER_SEM) ? barrierSemInit(&b, semid, 0, procs)
+		: barrierFutexInit(&b, &sh->bs, procs);
+
+	if (s == -1) {
+		fprintf(stderr, "barrier init error");
+		exit(EXIT_FAILURE);
+	}
+
+	sh->errors = 0;
+	start = nowSec();
+
+	for (int j = 0; j < procs; j++) {
+		switch (fork()) {
+		case -1:
+			fprintf(stderr, "fork error");
+			exit(EXIT_FAILURE);
+
+		case 0:
+			for (long r = 1; r <= rounds; r++) {
+				sh->round[j] = r;
+
+				if (barrierWait(&b) == -1) {
+					_exit(EXIT_FAILURE);
+				}
+
+				/* Everyone has reached r and nobody can pass r + 1 without us */
+				for (int k = 0; k < procs; k++) {
+					long seen = __atomic_load_n(&sh->round[k], __ATOMIC_ACQUIRE);
+
+					if (seen < r || seen > r + 1) {
+						__atomic_add_fetch(&sh->errors, 1, __ATOMIC_RELAXED);
+					}
+				}
+
+				/* Keep the next round's store ordered after this check */
+				if (barrierWait(&b) == -1) {
+					_exit(EXIT_FAILURE);
+				}
+			}
+
+			_exit(EXIT_SUCCESS);
+		}
+	}
+
+	while (wait(NULL) > 0) {
+		continue;
+	}
+
+	return (nowSec() - start) / (2 * rounds);
+}
+
+int main(int argc, char *argv[])
+{
+	long rounds = (argc > 1) ? atol(argv[1]) : 2000;
+	int maxProcs = (argc > 2) ? atoi(argv[2]) : 64;
+	struct bench_shared *sh;
+	double sem, fut;
+	int semid;
+
+	if (maxProcs < 2 || maxProcs > MAX_PROCS) {
+		fprintf(stderr, "max-processes must be 2..%d\n", MAX_PROCS);
+		exit(EXIT_FAILURE);
+	}
+
+	sh = mmap(NULL, sizeof(*sh), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	semid = semget(IPC_PRIVATE, BARRIER_NSEMS, IPC_CREAT | S_IRUSR | S_IWUSR);
+
+	if (sh == MAP_FAILED || semid == -1) {
+		fprintf(stderr, "setup error");
+		exit(EXIT_FAILURE);
+	}
+
+	printf("%ld rounds\nprocs  semop-usec/round  futex-usec/round  errors\n", rounds);
+
+	for (int procs = 2; procs <= maxProcs; procs *= 2) {
+		int errors;
+
+		sem = run(sh, semid, BARRIER_SEM, procs, rounds);
+		errors = sh->errors;
+		fut = run(sh, semid, BARRIER_FUTEX, procs, rounds);
+		errors += sh->errors;
+
+		printf("%5d %17.2f %17.2f %7d\n", procs, sem * 1e6, fut * 1e6, errors);
+	}
+
+	semctl(semid, 0, IPC_RMID);
+	exit(EXIT_SUCCESS);
+}
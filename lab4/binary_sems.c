@@ -1,16 +1,234 @@
 #include <sys/types.h>
 #include <sys/sem.h>
+#include <sys/shm.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 #include <errno.h>
+#include <unistd.h>
 #include "semun.h"
 #include "binary_sems.h"
 
 Boolean bsUseSemUndo = FALSE;
+Boolean bsUseFutex = FALSE;
+
+/* Futex backend: the "semaphore set" is a segment holding one of these */
+struct futex_sem {
+	int val; /* Semaphore value, also the futex word */
+	int waiters; /* Processes sleeping or about to sleep on val */
+};
+
+struct futex_set {
+	int removed; /* Set by removeSemSet(), sleepers then get EIDRM */
+	struct futex_sem sems[];
+};
+
+#define MAX_ATTACHED 16 /* Sets one process can use at a time */
+
+static struct {
+	int shmid;
+	int nsems; /* From the segment size */
+	struct futex_set *set;
+} attached[MAX_ATTACHED];
+static int nattached;
+
+int futexWait(int *addr, int val, const struct timespec *timeout)
+{
+	return syscall(SYS_futex, addr, FUTEX_WAIT, val, timeout, NULL, 0);
+}
+
+int futexWake(int *addr, int n)
+{
+	return syscall(SYS_futex, addr, FUTEX_WAKE, n, NULL, NULL, 0);
+}
+
+/* Unmap slot j and move the last entry into it, so a removed set's segment
+   can actually go away */
+static void futexDetach(int j)
+{
+	shmdt(attached[j].set);
+	attached[j] = attached[--nattached];
+}
+
+/* Whether slot j's set is gone: removed by removeSemSet() anywhere (the
+   segment stays readable while attached), or the id no longer valid */
+static int futexStale(int j)
+{
+	struct shmid_ds ds;
+
+	return __atomic_load_n(&attached[j].set->removed, __ATOMIC_ACQUIRE) ||
+	       (shmctl(attached[j].shmid, IPC_STAT, &ds) == -1 && (errno == EINVAL || errno == EIDRM));
+}
+
+/* Attach on first use and keep the mapping, the fast path must not pay for
+   shmat(). Returns the table slot or -1 with errno set like semop(). */
+static int futexAttach(int shmid)
+{
+	struct shmid_ds ds;
+	struct futex_set *set;
+	int j;
+
+	for (j = 0; j < nattached; j++) {
+		if (attached[j].shmid == shmid) {
+			return j;
+		}
+	}
+
+	for (j = nattached - 1; nattached == MAX_ATTACHED && j >= 0; j--) {
+		if (futexStale(j)) { /* Full: make room by dropping dead sets */
+			futexDetach(j);
+		}
+	}
+
+	if (nattached == MAX_ATTACHED) {
+		errno = ENOMEM;
+		return -1;
+	}
+
+	if (shmctl(shmid, IPC_STAT, &ds) == -1 || (set = shmat(shmid, NULL, 0)) == (void *) -1) {
+		return -1; /* EINVAL/EIDRM for a bad or removed id, like semop() */
+	}
+
+	attached[nattached].shmid = shmid;
+	attached[nattached].nsems = (ds.shm_segsz - sizeof(struct futex_set)) / sizeof(struct futex_sem);
+	attached[nattached].set = set;
+	return nattached++;
+}
+
+static struct futex_sem *futexSem(int shmid, int semNum)
+{
+	int j = futexAttach(shmid);
+
+	if (j == -1) {
+		return NULL;
+	}
+
+	if (__atomic_load_n(&attached[j].set->removed, __ATOMIC_ACQUIRE)) {
+		futexDetach(j); /* Let the segment go */
+		errno = EIDRM;
+		return NULL;
+	}
+
+	if (semNum < 0 || semNum >= attached[j].nsems) {
+		errno = EFBIG;
+		return NULL;
+	}
+
+	return &attached[j].set->sems[semNum];
+}
+
+int getSemSet(key_t key, int nsems, int flags)
+{
+	if (!bsUseFutex) {
+		return semget(key, nsems, flags);
+	}
+
+	/* A new segment is zero-filled: every counter starts at 0 like semget() */
+	return shmget(key, sizeof(struct futex_set) + nsems * sizeof(struct futex_sem), flags);
+}
+
+int removeSemSet(int semId)
+{
+	union semun dummy;
+	struct futex_set *set;
+	int j, n;
+
+	if (!bsUseFutex) {
+		return semctl(semId, 0, IPC_RMID, dummy);
+	}
+
+	if ((j = futexAttach(semId)) == -1) {
+		return -1;
+	}
+
+	set = attached[j].set;
+	__atomic_store_n(&set->removed, 1, __ATOMIC_SEQ_CST);
+
+	/* Bump each counter so a process about to sleep sees a changed value,
+	   and wake the ones already asleep; both then find 'removed' set */
+	for (n = 0; n < attached[j].nsems; n++) {
+		__atomic_add_fetch(&set->sems[n].val, 1, __ATOMIC_SEQ_CST);
+		futexWake(&set->sems[n].val, __INT_MAX__);
+	}
+
+	futexDetach(j);
+	return shmctl(semId, IPC_RMID, NULL);
+}
+
+static int futexInit(int semId, int semNum, int val)
+{
+	struct futex_sem *sem = futexSem(semId, semNum);
+
+	if (sem == NULL) {
+		return -1;
+	}
+
+	__atomic_store_n(&sem->val, val, __ATOMIC_SEQ_CST);
+
+	if (__atomic_load_n(&sem->waiters, __ATOMIC_SEQ_CST) > 0) {
+		futexWake(&sem->val, __INT_MAX__);
+	}
+
+	return 0;
+}
+
+static int futexReserve(int semId, int semNum)
+{
+	struct futex_sem *sem;
+	int v;
+
+	for (;;) {
+		if ((sem = futexSem(semId, semNum)) == NULL) {
+			return -1; /* Also when the set was removed while we slept */
+		}
+
+		/* Fast path: take a unit without entering the kernel */
+		v = __atomic_load_n(&sem->val, __ATOMIC_RELAXED);
+
+		while (v > 0) {
+			if (__atomic_compare_exchange_n(&sem->val, &v, v - 1, 0,
+					__ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+				return 0;
+			}
+		}
+
+		/* Announce ourselves before sleeping: releaseSem() only calls
+		   futex() when it sees a waiter, and FUTEX_WAIT rechecks val == 0 */
+		__atomic_add_fetch(&sem->waiters, 1, __ATOMIC_SEQ_CST);
+		v = futexWait(&sem->val, 0, NULL);
+		__atomic_sub_fetch(&sem->waiters, 1, __ATOMIC_SEQ_CST);
+
+		if (v == -1 && errno == EINTR) {
+			return -1; /* As semop() does */
+		}
+	}
+}
+
+static int futexRelease(int semId, int semNum)
+{
+	struct futex_sem *sem = futexSem(semId, semNum);
+
+	if (sem == NULL) {
+		return -1;
+	}
+
+	__atomic_add_fetch(&sem->val, 1, __ATOMIC_SEQ_CST);
+
+	if (__atomic_load_n(&sem->waiters, __ATOMIC_SEQ_CST) > 0) {
+		futexWake(&sem->val, 1);
+	}
+
+	return 0;
+}
 
 int initSemAvailable(int semId, int semNum) /* Initialize semaphore to 1 (i.e., "available") */
 {
 	union semun arg;
 	arg.val = 1;
 
+	if (bsUseFutex) {
+		return futexInit(semId, semNum, 1);
+	}
+
 	return semctl(semId, semNum, SETVAL, arg);
 }
 
@@ -19,6 +237,10 @@ int initSemInUse(int semId, int semNum) /* Initialize semaphore to 0 (i.e., "in
 	union semun arg;
 	arg.val = 0;
 
+	if (bsUseFutex) {
+		return futexInit(semId, semNum, 0);
+	}
+
 	return semctl(semId, semNum, SETVAL, arg);
 }
 
@@ -29,6 +251,15 @@ int reserveSem(int semId, int semNum) /* Reserve semaphore - decrement it by 1 *
 	sops.sem_op = -1;
 	sops.sem_flg = bsUseSemUndo ? SEM_UNDO : 0;
 
+	if (bsUseFutex) {
+		if (bsUseSemUndo) {
+			errno = EINVAL;
+			return -1;
+		}
+
+		return futexReserve(semId, semNum);
+	}
+
 	return semop(semId, &sops, 1);
 }
 
@@ -39,5 +270,14 @@ int releaseSem(int semId, int semNum) /* Release semaphore - increment it by 1 *
 	sops.sem_op = 1;
 	sops.sem_flg = bsUseSemUndo ? SEM_UNDO : 0;
 
+	if (bsUseFutex) {
+		if (bsUseSemUndo) {
+			errno = EINVAL;
+			return -1;
+		}
+
+		return futexRelease(semId, semNum);
+	}
+
 	return semop(semId, &sops, 1);
 }
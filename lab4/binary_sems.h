@@ -1,12 +1,25 @@
 #ifndef BINARY_SEMS_H /* Prevent accidental double inclusion */
 #define BINARY_SEMS_H
 
+#include <time.h>
+#include <sys/types.h>
+
 typedef enum { FALSE, TRUE } Boolean;
 extern Boolean bsUseSemUndo; /* Use SEM_UNDO during semop()? */
+extern Boolean bsUseFutex; /* Counters in shared memory, futex() only to sleep/wake */
+
+/* With bsUseFutex the set is a shared memory segment of counters and semId
+   is its shmid. Every process using the set must make the same choice, and
+   SEM_UNDO is not available (EINVAL). */
+int getSemSet(key_t key, int nsems, int flags); /* semget() or equivalent */
+int removeSemSet(int semId);
 
 int initSemAvailable(int semId, int semNum);
 int initSemInUse(int semId, int semNum);
 int reserveSem(int semId, int semNum);
 int releaseSem(int semId, int semNum);
 
+int futexWait(int *addr, int val, const struct timespec *timeout); /* Shared futexes */
+int futexWake(int *addr, int n);
+
 #endif
@@ -0,0 +1,112 @@
+/*
+ * Compile: gcc -O2 -o bs_bench bs_bench.c binary_sems.c
+ * Run: ./bs_bench [rounds]
+ *
+ * Compares the System V and futex backends of binary_sems:
+ * uncontended - one process reserves and releases the same semaphore;
+ * ping-pong   - two processes hand the turn back and forth on two semaphores,
+ *               the pattern of shm_writer/shm_reader.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "shm.h"
+
+static double nowSec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double uncontended(int semid, long rounds)
+{
+	double start = nowSec();
+
+	for (long j = 0; j < rounds; j++) {
+		if (reserveSem(semid, WRITE_SEM) == -1 || releaseSem(semid, WRITE_SEM) == -1) {
+			fprintf(stderr, "reserveSem/releaseSem error");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	return nowSec() - start;
+}
+
+static double pingPong(int semid, long rounds)
+{
+	double start = nowSec();
+	pid_t child;
+
+	child = fork();
+
+	if (child == -1) {
+		fprintf(stderr, "fork error");
+		exit(EXIT_FAILURE);
+	}
+
+	if (child == 0) { /* Reader side */
+		for (long j = 0; j < rounds; j++) {
+			if (reserveSem(semid, READ_SEM) == -1 || releaseSem(semid, WRITE_SEM) == -1) {
+				_exit(EXIT_FAILURE);
+			}
+		}
+
+		_exit(EXIT_SUCCESS);
+	}
+
+	for (long j = 0; j < rounds; j++) { /* Writer side */
+		if (reserveSem(semid, WRITE_SEM) == -1 || releaseSem(semid, READ_SEM) == -1) {
+			fprintf(stderr, "reserveSem/releaseSem error");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	waitpid(child, NULL, 0);
+	return nowSec() - start;
+}
+
+static void run(const char *name, long rounds)
+{
+	double u, p;
+	int semid;
+
+	semid = getSemSet(IPC_PRIVATE, 2, IPC_CREAT | OBJ_PERMS);
+
+	if (semid == -1) {
+		fprintf(stderr, "getSemSet error");
+		exit(EXIT_FAILURE);
+	}
+
+	if (initSemAvailable(semid, WRITE_SEM) == -1 || initSemInUse(semid, READ_SEM) == -1) {
+		fprintf(stderr, "initSem error");
+		exit(EXIT_FAILURE);
+	}
+
+	u = uncontended(semid, rounds);
+	p = pingPong(semid, rounds);
+
+	printf("%-8s uncontended %8.1f ns/op   ping-pong %8.1f ns/round trip\n",
+		name, u / (2 * rounds) * 1e9, p / rounds * 1e9);
+
+	if (removeSemSet(semid) == -1) {
+		fprintf(stderr, "removeSemSet error");
+		exit(EXIT_FAILURE);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	long rounds = (argc > 1) ? atol(argv[1]) : 200000;
+
+	bsUseFutex = FALSE;
+	run("System V", rounds);
+	bsUseFutex = TRUE;
+	run("futex", rounds);
+
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,140 @@
+/*
+ * Compile: gcc -O2 -o robust_bench robust_bench.c robust_lock.c binary_sems.c -pthread
+ * Run: ./robust_bench [rounds]
+ *
+ * 1. Cost of one lock + unlock: robust mutex, semop(), semop() + SEM_UNDO.
+ * 2. A child dies in the middle of filling a shmseg. With SEM_UNDO the
+ *    semaphore comes back but the half-written transfer stays; with the
+ *    robust lock the next process gets EOWNERDEAD and repairs it first.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "shm.h"
+#include "robust_lock.h"
+
+struct robust_seg { /* shmseg with its lock and an in-progress marker */
+	struct robust_lock lock;
+	int dirty; /* Set while a writer is changing seg */
+	struct shmseg seg;
+};
+
+static double nowSec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int repairSeg(void *data) /* Drop a transfer its writer did not finish */
+{
+	struct robust_seg *rs = data;
+
+	if (rs->dirty) {
+		printf("  recovery: discarding half-written transfer (cnt=%d)\n", rs->seg.cnt);
+		rs->seg.cnt = 0;
+		rs->dirty = 0;
+	}
+
+	return 0;
+}
+
+static void fillAndDie(struct robust_seg *rs) /* Writer killed mid-update */
+{
+	rs->dirty = 1;
+	rs->seg.cnt = BUF_SIZE;
+	memset(rs->seg.buf, 'x', BUF_SIZE / 2);
+	_exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+	long rounds = (argc > 1) ? atol(argv[1]) : 1000000;
+	struct robust_seg *rs;
+	int semid, shmid, val;
+	double t;
+	pid_t child;
+
+	shmid = shmget(IPC_PRIVATE, sizeof(struct robust_seg), IPC_CREAT | OBJ_PERMS);
+	semid = semget(IPC_PRIVATE, 1, IPC_CREAT | OBJ_PERMS);
+
+	if (shmid == -1 || semid == -1) {
+		fprintf(stderr, "shmget/semget error");
+		exit(EXIT_FAILURE);
+	}
+
+	rs = shmat(shmid, NULL, 0);
+
+	if (rs == (void *) -1 || robustInit(&rs->lock) == -1 || initSemAvailable(semid, 0) == -1) {
+		fprintf(stderr, "init error");
+		exit(EXIT_FAILURE);
+	}
+
+	/* 1. Uncontended lock + unlock */
+	t = nowSec();
+
+	for (long j = 0; j < rounds; j++) {
+		robustLock(&rs->lock, repairSeg, rs);
+		robustUnlock(&rs->lock);
+	}
+
+	printf("robust mutex      %8.1f ns/op\n", (nowSec() - t) / rounds * 1e9);
+
+	for (int undo = 0; undo <= 1; undo++) {
+		bsUseSemUndo = undo;
+		t = nowSec();
+
+		for (long j = 0; j < rounds; j++) {
+			reserveSem(semid, 0);
+			releaseSem(semid, 0);
+		}
+
+		printf("semop%-12s %8.1f ns/op\n", undo ? " + SEM_UNDO" : "", (nowSec() - t) / rounds * 1e9);
+	}
+
+	/* 2. Owner dies holding the lock */
+	printf("\nSEM_UNDO: writer dies in the critical section\n");
+	rs->dirty = 0;
+	bsUseSemUndo = TRUE;
+
+	if ((child = fork()) == 0) {
+		reserveSem(semid, 0);
+		fillAndDie(rs);
+	}
+
+	waitpid(child, NULL, 0);
+	val = semctl(semid, 0, GETVAL);
+
+	if (reserveSem(semid, 0) == 0) {
+		printf("  semaphore back to %d, but dirty=%d cnt=%d: nobody repairs the data\n",
+			val, rs->dirty, rs->seg.cnt);
+		releaseSem(semid, 0);
+	}
+
+	printf("\nRobust lock: writer dies in the critical section\n");
+	rs->dirty = 0;
+	rs->seg.cnt = 0;
+
+	if ((child = fork()) == 0) {
+		robustLock(&rs->lock, repairSeg, rs);
+		fillAndDie(rs);
+	}
+
+	waitpid(child, NULL, 0);
+
+	if (robustLock(&rs->lock, repairSeg, rs) == 0) {
+		printf("  lock acquired, dirty=%d cnt=%d, %d recoveries\n",
+			rs->dirty, rs->seg.cnt, rs->lock.recoveries);
+		robustUnlock(&rs->lock);
+	}
+
+	semctl(semid, 0, IPC_RMID);
+	shmdt(rs);
+	shmctl(shmid, IPC_RMID, NULL);
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,61 @@
+#include <errno.h>
+#include "robust_lock.h"
+
+/* pthread calls return the error, the rest of lab4 reports it in errno */
+static int check(int s)
+{
+	if (s != 0) {
+		errno = s;
+		return -1;
+	}
+
+	return 0;
+}
+
+int robustInit(struct robust_lock *l)
+{
+	pthread_mutexattr_t attr;
+	int s;
+
+	if ((s = pthread_mutexattr_init(&attr)) != 0) {
+		return check(s);
+	}
+
+	s = pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+
+	if (s == 0) {
+		s = pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+	}
+
+	if (s == 0) {
+		s = pthread_mutex_init(&l->mtx, &attr);
+	}
+
+	pthread_mutexattr_destroy(&attr);
+	l->recoveries = 0;
+	return check(s);
+}
+
+int robustLock(struct robust_lock *l, robust_recover_fn recover, void *data)
+{
+	int s = pthread_mutex_lock(&l->mtx);
+
+	if (s != EOWNERDEAD) {
+		return check(s); /* ENOTRECOVERABLE if an earlier recovery gave up */
+	}
+
+	/* We hold the lock, but the data may be half updated */
+	if (recover != NULL && recover(data) == -1) {
+		pthread_mutex_unlock(&l->mtx); /* Without consistent(): unusable from now on */
+		errno = ENOTRECOVERABLE;
+		return -1;
+	}
+
+	l->recoveries++;
+	return check(pthread_mutex_consistent(&l->mtx));
+}
+
+int robustUnlock(struct robust_lock *l)
+{
+	return check(pthread_mutex_unlock(&l->mtx));
+}
@@ -0,0 +1,24 @@
+#ifndef ROBUST_LOCK_H /* Prevent accidental double inclusion */
+#define ROBUST_LOCK_H
+
+#include <pthread.h>
+
+/* Process-shared robust mutex, placed in shared memory next to the data it
+   guards. When a holder dies the kernel hands the lock to the next process
+   with EOWNERDEAD; robustLock() then runs the caller's recovery function on
+   the data before marking the mutex consistent again. Unlike SEM_UNDO this
+   costs nothing per operation and repairs the data, not just the count. */
+struct robust_lock {
+	pthread_mutex_t mtx;
+	int recoveries; /* Times a dead owner's state was repaired */
+};
+
+/* Called with the lock held after its previous owner died. Returns 0 if
+   the data is usable again, -1 to give up (the lock becomes unusable). */
+typedef int (*robust_recover_fn)(void *data);
+
+int robustInit(struct robust_lock *l); /* Once, by whoever creates the segment */
+int robustLock(struct robust_lock *l, robust_recover_fn recover, void *data);
+int robustUnlock(struct robust_lock *l);
+
+#endif
@@ -0,0 +1,177 @@
+/*
+ * Compile: gcc -O2 -o rw_bench rw_bench.c rw_sems.c binary_sems.c
+ * Run: ./rw_bench [max-processes] [seconds] [write-percent]
+ *
+ * Read-mostly load on a shared table: each process loops, writing it
+ * write-percent of the time and otherwise reading all of it. Compares a
+ * binary semaphore (reserveSem/releaseSem) with the reader-writer lock as
+ * the number of processes doubles. Readers check every read is consistent.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/sem.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "rw_sems.h"
+
+#define TABLE_SIZE 512 /* ints in the shared table */
+#define MUTEX_SEM 0
+#define RW_BASE 1
+
+struct result {
+	long reads, writes, torn;
+};
+
+static int *table;
+
+static double nowSec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int readTable(void) /* Returns 1 if a write was seen half done */
+{
+	int first = table[0], torn = 0;
+
+	for (int j = 1; j < TABLE_SIZE; j++) {
+		torn |= (((volatile int *) table)[j] != first);
+	}
+
+	return torn;
+}
+
+static void writeTable(int v)
+{
+	for (int j = 0; j < TABLE_SIZE; j++) {
+		((volatile int *) table)[j] = v;
+	}
+}
+
+static void worker(int semid, int useRw, double end, int writePct, int fd)
+{
+	struct result r = { 0, 0, 0 };
+	unsigned seed = getpid();
+	int s;
+
+	while (nowSec() < end) {
+		int write = rand_r(&seed) % 100 < writePct;
+
+		if (useRw) {
+			s = write ? writeLock(semid, RW_BASE) : readLock(semid, RW_BASE);
+		} else {
+			s = reserveSem(semid, MUTEX_SEM);
+		}
+
+		if (s == -1) {
+			_exit(EXIT_FAILURE);
+		}
+
+		if (write) {
+			writeTable(rand_r(&seed));
+			r.writes++;
+		} else {
+			r.torn += readTable();
+			r.reads++;
+		}
+
+		if (useRw) {
+			s = write ? writeUnlock(semid, RW_BASE) : readUnlock(semid, RW_BASE);
+		} else {
+			s = releaseSem(semid, MUTEX_SEM);
+		}
+
+		if (s == -1) {
+			_exit(EXIT_FAILURE);
+		}
+	}
+
+	write(fd, &r, sizeof(r));
+	_exit(EXIT_SUCCESS);
+}
+
+static struct result run(int semid, int useRw, int procs, double seconds, int writePct)
+{
+	struct result r, sum = { 0, 0, 0 };
+	double end = nowSec() + seconds;
+	int fds[2];
+
+	if (pipe(fds) == -1) {
+		fprintf(stderr, "pipe error");
+		exit(EXIT_FAILURE);
+	}
+
+	for (int j = 0; j < procs; j++) {
+		pid_t pid = fork();
+
+		if (pid == -1) {
+			fprintf(stderr, "fork error");
+			exit(EXIT_FAILURE);
+		}
+
+		if (pid == 0) {
+			close(fds[0]);
+			worker(semid, useRw, end, writePct, fds[1]);
+		}
+	}
+
+	close(fds[1]);
+
+	while (read(fds[0], &r, sizeof(r)) == sizeof(r)) {
+		sum.reads += r.reads;
+		sum.writes += r.writes;
+		sum.torn += r.torn;
+	}
+
+	close(fds[0]);
+
+	while (wait(NULL) > 0) {
+		continue;
+	}
+
+	return sum;
+}
+
+int main(int argc, char *argv[])
+{
+	int maxProcs = (argc > 1) ? atoi(argv[1]) : 16;
+	double seconds = (argc > 2) ? atof(argv[2]) : 1;
+	int writePct = (argc > 3) ? atoi(argv[3]) : 1;
+	struct result m, rw;
+	int semid;
+
+	table = mmap(NULL, TABLE_SIZE * sizeof(int), PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	semid = getSemSet(IPC_PRIVATE, 1 + RW_NSEMS, IPC_CREAT | S_IRUSR | S_IWUSR);
+
+	if (table == MAP_FAILED || semid == -1) {
+		fprintf(stderr, "setup error");
+		exit(EXIT_FAILURE);
+	}
+
+	if (initSemAvailable(semid, MUTEX_SEM) == -1 || initRwLock(semid, RW_BASE) == -1) {
+		fprintf(stderr, "init error");
+		exit(EXIT_FAILURE);
+	}
+
+	printf("%d%% writes, %.1f s per run\n", writePct, seconds);
+	printf("procs  reserveSem-ops/s  rwlock-ops/s  speedup  torn-reads\n");
+
+	for (int procs = 1; procs <= maxProcs; procs *= 2) {
+		m = run(semid, 0, procs, seconds, writePct);
+		rw = run(semid, 1, procs, seconds, writePct);
+
+		printf("%5d %17.0f %13.0f %7.2fx %11ld\n", procs,
+			(m.reads + m.writes) / seconds, (rw.reads + rw.writes) / seconds,
+			(double) (rw.reads + rw.writes) / (m.reads + m.writes), m.torn + rw.torn);
+	}
+
+	removeSemSet(semid);
+	exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,118 @@
+#define _GNU_SOURCE /* semtimedop() */
+#include <sys/types.h>
+#include <sys/sem.h>
+#include <errno.h>
+#include "semun.h"
+#include "rw_sems.h"
+
+static void setOp(struct sembuf *sop, int base, int sem, int op, int flags)
+{
+	sop->sem_num = base + sem;
+	sop->sem_op = op;
+	sop->sem_flg = flags | (bsUseSemUndo ? SEM_UNDO : 0);
+}
+
+int initRwLock(int semId, int base) /* Unlocked: all three counters 0 */
+{
+	union semun arg;
+	arg.val = 0;
+
+	for (int j = 0; j < RW_NSEMS; j++) {
+		if (semctl(semId, base + j, SETVAL, arg) == -1) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int readOp(int semId, int base, int flags, const struct timespec *timeout)
+{
+	struct sembuf sops[2];
+
+	/* Wait until no writer holds or wants the lock, then count ourselves in */
+	setOp(&sops[0], base, RW_WWAIT, 0, flags);
+	setOp(&sops[1], base, RW_READERS, 1, flags);
+
+	return semtimedop(semId, sops, 2, timeout);
+}
+
+int readLock(int semId, int base)
+{
+	return readOp(semId, base, 0, NULL);
+}
+
+int tryReadLock(int semId, int base)
+{
+	return readOp(semId, base, IPC_NOWAIT, NULL);
+}
+
+int timedReadLock(int semId, int base, const struct timespec *timeout)
+{
+	return readOp(semId, base, 0, timeout);
+}
+
+int readUnlock(int semId, int base)
+{
+	struct sembuf sop;
+
+	setOp(&sop, base, RW_READERS, -1, 0);
+	return semop(semId, &sop, 1);
+}
+
+int tryWriteLock(int semId, int base)
+{
+	struct sembuf sops[4];
+
+	/* Announce and take the lock in one step, or do neither */
+	setOp(&sops[0], base, RW_READERS, 0, IPC_NOWAIT);
+	setOp(&sops[1], base, RW_WRITER, 0, IPC_NOWAIT);
+	setOp(&sops[2], base, RW_WRITER, 1, 0);
+	setOp(&sops[3], base, RW_WWAIT, 1, 0);
+
+	return semop(semId, sops, 4);
+}
+
+int timedWriteLock(int semId, int base, const struct timespec *timeout)
+{
+	struct sembuf sops[3];
+	int savedErrno;
+
+	/* Announce first: from here on no new reader gets in */
+	setOp(&sops[0], base, RW_WWAIT, 1, 0);
+
+	if (semop(semId, sops, 1) == -1) {
+		return -1;
+	}
+
+	/* Then wait for the readers inside and any earlier writer to leave */
+	setOp(&sops[0], base, RW_READERS, 0, 0);
+	setOp(&sops[1], base, RW_WRITER, 0, 0);
+	setOp(&sops[2], base, RW_WRITER, 1, 0);
+
+	if (semtimedop(semId, sops, 3, timeout) == 0) {
+		return 0;
+	}
+
+	/* Timed out or interrupted: withdraw, which lets readers back in */
+	savedErrno = errno;
+	setOp(&sops[0], base, RW_WWAIT, -1, 0);
+	semop(semId, sops, 1);
+	errno = savedErrno;
+	return -1;
+}
+
+int writeLock(int semId, int base)
+{
+	return timedWriteLock(semId, base, NULL);
+}
+
+int writeUnlock(int semId, int base)
+{
+	struct sembuf sops[2];
+
+	setOp(&sops[0], base, RW_WRITER, -1, 0);
+	setOp(&sops[1], base, RW_WWAIT, -1, 0);
+
+	return semop(semId, sops, 2);
+}
@@ -0,0 +1,32 @@
+#ifndef RW_SEMS_H /* Prevent accidental double inclusion */
+#define RW_SEMS_H
+
+#include <time.h>
+#include "binary_sems.h" /* bsUseSemUndo applies to these locks too */
+
+/* A reader-writer lock takes three semaphores of a set, from 'base':
+     RW_READERS - readers holding the lock
+     RW_WRITER  - 1 while a writer holds it
+     RW_WWAIT   - writers holding or waiting for it
+   Readers enter only while RW_WWAIT is 0, so a waiting writer stops new
+   readers from getting in and cannot be starved. Every change is a single
+   semop(), with SEM_UNDO if bsUseSemUndo is set, so a crashed holder or
+   waiter leaves the lock as if it had never been there. */
+#define RW_READERS 0
+#define RW_WRITER 1
+#define RW_WWAIT 2
+#define RW_NSEMS 3 /* Semaphores used per lock */
+
+int initRwLock(int semId, int base);
+
+int readLock(int semId, int base);
+int tryReadLock(int semId, int base); /* -1 with EAGAIN if a writer holds or waits */
+int timedReadLock(int semId, int base, const struct timespec *timeout);
+int readUnlock(int semId, int base);
+
+int writeLock(int semId, int base);
+int tryWriteLock(int semId, int base);
+int timedWriteLock(int semId, int base, const struct timespec *timeout);
+int writeUnlock(int semId, int base);
+
+#endif
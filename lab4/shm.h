@@ -12,8 +12,11 @@
 #ifndef BUF_SIZE /* Allow "cc -D" to override definition */
 #define BUF_SIZE 1024 /* Size of transfer buffer */
 #endif
+#define SHM_FLAG_LZ 0x1 /* 'buf' holds one lz_codec block */
+#define RAW_SIZE (4 * BUF_SIZE) /* Max bytes a compressed 'buf' expands to */
 
 struct shmseg { /* Defines structure of shared memory segment */
 	int cnt; /* Number of bytes used in 'buf' */
+	int flags; /* SHM_FLAG_LZ or 0 for plain data */
 	char buf[BUF_SIZE]; /* Data being transferred */
 };
@@ -1,18 +1,31 @@
+/*
+ * Compile: gcc -o shm_reader shm_reader.c binary_sems.c ../lab1/lz_codec.c (for -z input)
+ * Run: ./shm_reader [-f] > output
+ */
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include "shm.h"
+#include "../lab1/lz_codec.h"
 
 int main(int argc, char *argv[])
 {
-	int semid, shmid, transfers, bytes;
+	int semid, shmid, transfers, bytes, n;
+	static char raw[RAW_SIZE]; /* Expanded SHM_FLAG_LZ block */
 	struct shmseg *shmp;
+	const char *data;
+
+	if (argc > 1 && strcmp(argv[1], "-f") == 0) {
+		bsUseFutex = TRUE; /* Writer was started with -f */
+	}
 
 	/* Get IDs for semaphore set and shared memory created by writer */
-	semid = semget(SEM_KEY, 0, 0);
+	semid = getSemSet(SEM_KEY, 0, 0);
 
 	if (semid == -1) {
-		fprintf(stderr, "semget error");
+		fprintf(stderr, "getSemSet error");
 		exit(EXIT_FAILURE);
 	}
 
@@ -41,9 +54,22 @@ int main(int argc, char *argv[])
 			break;
 		}
 
-		bytes += shmp->cnt;
+		data = shmp->buf;
+		n = shmp->cnt;
+
+		if (shmp->flags & SHM_FLAG_LZ) {
+			n = lzDecompress(shmp->buf, shmp->cnt, raw, RAW_SIZE);
+			data = raw;
+
+			if (n == -1) {
+				fprintf(stderr, "lzDecompress error");
+				exit(EXIT_FAILURE);
+			}
+		}
+
+		bytes += n;
 
-		if (write(STDOUT_FILENO, shmp->buf, shmp->cnt) != shmp->cnt) {
+		if (write(STDOUT_FILENO, data, n) != n) {
 			fprintf(stderr, "partial/failed write");
 			exit(EXIT_FAILURE);
 		}
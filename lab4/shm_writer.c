@@ -1,18 +1,72 @@
+/*
+ * Compile: gcc -o shm_writer shm_writer.c binary_sems.c ../lab1/lz_codec.c (for -z)
+ * Run: ./shm_writer [-z] [-f] < input
+ */
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
-#include "semun.h"
 #include "shm.h"
+#include "../lab1/lz_codec.h"
+
+static char raw[RAW_SIZE]; /* Input not yet handed to the reader */
+static int rawLen;
+
+/* Fill 'buf' from stdin through lz_codec: a compressed block carries up to
+   RAW_SIZE bytes, input that does not shrink goes out plain. Returns the
+   input bytes consumed, 0 at EOF, -1 on read error. */
+static int fillCompressed(struct shmseg *shmp)
+{
+	size_t c;
+	int n;
+
+	n = read(STDIN_FILENO, raw + rawLen, RAW_SIZE - rawLen);
+
+	if (n == -1) {
+		return -1;
+	}
+
+	rawLen += n;
+
+	c = lzCompress(raw, rawLen, shmp->buf, BUF_SIZE);
+
+	if (c > 0) {
+		shmp->cnt = c;
+		shmp->flags = SHM_FLAG_LZ;
+		n = rawLen;
+	} else {
+		n = (rawLen < BUF_SIZE) ? rawLen : BUF_SIZE;
+		memcpy(shmp->buf, raw, n);
+		shmp->cnt = n;
+		shmp->flags = 0;
+	}
+
+	memmove(raw, raw + n, rawLen - n);
+	rawLen -= n;
+	return n;
+}
 
 int main(int argc, char *argv[])
 {
-	int semid, shmid, bytes, transfers;
+	int semid, shmid, bytes, transfers, n, opt, compress = 0;
 	struct shmseg *shmp;
-	union semun dummy;
-	semid = semget(SEM_KEY, 2, IPC_CREAT | OBJ_PERMS);
+
+	while ((opt = getopt(argc, argv, "zf")) != -1) {
+		if (opt == 'z') {
+			compress = 1; /* lz_codec on each transfer */
+		} else if (opt == 'f') {
+			bsUseFutex = TRUE; /* Reader must be run with -f too */
+		} else {
+			fprintf(stderr, "Usage: %s [-z] [-f]\n", argv[0]);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	semid = getSemSet(SEM_KEY, 2, IPC_CREAT | OBJ_PERMS);
 
 	if (semid == -1) {
-		fprintf(stderr, "semget error");
+		fprintf(stderr, "getSemSet error");
 		exit(EXIT_FAILURE);
 	}
 
@@ -41,15 +95,20 @@ int main(int argc, char *argv[])
 	}
 
 	/* Transfer blocks of data from stdin to shared memory */
-	for (transfers = 0, bytes = 0; ; transfers++, bytes += shmp->cnt) {
+	for (transfers = 0, bytes = 0; ; transfers++, bytes += n) {
 		if (reserveSem(semid, WRITE_SEM) == -1) { /* Wait for our turn */
 			fprintf(stderr, "reserveSem error");
 			exit(EXIT_FAILURE);
 		}
 
-		shmp->cnt = read(STDIN_FILENO, shmp->buf, BUF_SIZE);
+		if (compress) {
+			n = fillCompressed(shmp);
+		} else {
+			n = shmp->cnt = read(STDIN_FILENO, shmp->buf, BUF_SIZE);
+			shmp->flags = 0;
+		}
 
-		if (shmp->cnt == -1) {
+		if (n == -1) {
 			fprintf(stderr, "read error");
 			exit(EXIT_FAILURE);
 		}
@@ -73,8 +132,8 @@ int main(int argc, char *argv[])
 		exit(EXIT_FAILURE);
 	}
 
-	if (semctl(semid, 0, IPC_RMID, dummy) == -1) {
-		fprintf(stderr, "semctl error");
+	if (removeSemSet(semid) == -1) {
+		fprintf(stderr, "removeSemSet error");
 		exit(EXIT_FAILURE);
 	}
 
@@ -88,6 +147,6 @@ int main(int argc, char *argv[])
 		exit(EXIT_FAILURE);
 	}
 
-	printf("Sent %d bytes (%d transfers)\n", bytes, transfers);
+	printf("Sent %d bytes (%d transfers%s)\n", bytes, transfers, compress ? ", lz" : "");
 	exit(EXIT_SUCCESS);
 }
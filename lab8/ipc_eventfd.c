@@ -0,0 +1,345 @@
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/msg.h>
+#include <sys/sem.h>
+#include "ipc_eventfd.h"
+
+static pthread_once_t signalOnce = PTHREAD_ONCE_INIT;
+
+static void wakeHandler(int sig)
+{
+    (void) sig; /* Only there to make msgrcv()/semop() return EINTR */
+}
+
+static void installHandler(void)
+{
+    struct sigaction sa;
+
+    /* msgrcv() and semop() are never restarted after a handler, but leave
+       SA_RESTART out anyway so the intent is explicit */
+    memset(&sa, 0, sizeof(sa));
+    sigemptyset(&sa.sa_mask);
+    sa.sa_handler = wakeHandler;
+    sigaction(BRIDGE_SIGNAL, &sa, NULL);
+}
+
+/* Called with the lock held. The eventfd is only cleared by the reactor
+   when nothing is pending, so it is already non-zero if anything was */
+static void signalReady(struct ipc_bridge *b, int wasPending, long n)
+{
+    uint64_t one = 1;
+
+    b->events += n;
+
+    if (!wasPending) {
+        b->wakeups++;
+        write(b->efd, &one, sizeof(one));
+    }
+}
+
+static void helperFailed(struct ipc_bridge *b, int err)
+{
+    uint64_t one = 1;
+
+    pthread_mutex_lock(&b->lock);
+
+    if (!b->stop) { /* Wake the reactor so it sees the error */
+        b->error = err;
+        write(b->efd, &one, sizeof(one));
+    }
+
+    pthread_mutex_unlock(&b->lock);
+}
+
+static void *queueHelper(void *arg)
+{
+    struct ipc_bridge *b = arg;
+    unsigned slot, room, got, wasPending;
+    ssize_t n;
+
+    for (;;) {
+        pthread_mutex_lock(&b->lock);
+
+        while (b->count == BRIDGE_RING && !b->stop) {
+            pthread_cond_wait(&b->space, &b->lock);
+        }
+
+        if (b->stop) {
+            pthread_mutex_unlock(&b->lock);
+            break;
+        }
+
+        room = BRIDGE_RING - b->count;
+        slot = b->head + b->count;
+        pthread_mutex_unlock(&b->lock);
+
+        /* Free slots belong to the helper, fill them without the lock:
+           block for the first message, then take what is already there */
+        for (got = 0; got < room; got++) {
+            struct mbuf *m = &b->ring[(slot + got) % BRIDGE_RING];
+            int flags = MSG_NOERROR | (got > 0 ? IPC_NOWAIT : 0);
+
+            n = msgrcv(b->id, m, MAX_MTEXT, b->mtype, flags);
+
+            if (n == -1) {
+                break;
+            }
+
+            b->lens[(slot + got) % BRIDGE_RING] = n;
+        }
+
+        if (got > 0) {
+            pthread_mutex_lock(&b->lock);
+            wasPending = b->count > 0;
+            b->count += got;
+            signalReady(b, wasPending, got);
+            pthread_mutex_unlock(&b->lock);
+        }
+
+        if (got == 0 && errno != EINTR) {
+            helperFailed(b, errno);
+            break;
+        }
+
+        /* got > 0 ended on ENOMSG/EINTR, or on a hard error that the
+           blocking msgrcv() of the next round reports */
+    }
+
+    pthread_mutex_lock(&b->lock);
+    b->done = 1;
+    pthread_mutex_unlock(&b->lock);
+    return NULL;
+}
+
+static void *semHelper(void *arg)
+{
+    struct ipc_bridge *b = arg;
+    struct sembuf sop;
+    long taken;
+    int val, wasPending, stop;
+
+    sop.sem_num = b->semNum;
+    sop.sem_flg = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&b->lock);
+        stop = b->stop;
+        pthread_mutex_unlock(&b->lock);
+
+        if (stop) {
+            break;
+        }
+
+        sop.sem_op = -1;
+        sop.sem_flg = 0;
+
+        if (semop(b->id, &sop, 1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            helperFailed(b, errno);
+            break;
+        }
+
+        /* Take the rest of a burst in one more call */
+        taken = 1;
+        val = semctl(b->id, b->semNum, GETVAL);
+
+        if (val > 0) {
+            sop.sem_op = -((val < BRIDGE_SEM_BATCH - 1) ? val : BRIDGE_SEM_BATCH - 1);
+            sop.sem_flg = IPC_NOWAIT;
+
+            if (semop(b->id, &sop, 1) == 0) { /* EAGAIN: someone else got there */
+                taken -= sop.sem_op;
+            }
+        }
+
+        pthread_mutex_lock(&b->lock);
+        wasPending = b->units > 0;
+        b->units += taken;
+        signalReady(b, wasPending, taken);
+        pthread_mutex_unlock(&b->lock);
+    }
+
+    pthread_mutex_lock(&b->lock);
+    b->done = 1;
+    pthread_mutex_unlock(&b->lock);
+    return NULL;
+}
+
+static int bridgeStart(struct ipc_bridge *b, void *(*helper)(void *))
+{
+    pthread_attr_t attr;
+    int s;
+
+    pthread_once(&signalOnce, installHandler);
+
+    b->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (b->efd == -1) {
+        return -1;
+    }
+
+    b->stop = b->done = b->error = 0;
+    b->head = b->count = 0;
+    b->units = b->wakeups = b->events = 0;
+    pthread_mutex_init(&b->lock, NULL);
+    pthread_cond_init(&b->space, NULL);
+
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, BRIDGE_STACK);
+    s = pthread_create(&b->thread, &attr, helper, b);
+    pthread_attr_destroy(&attr);
+
+    if (s != 0) {
+        close(b->efd);
+        pthread_mutex_destroy(&b->lock);
+        pthread_cond_destroy(&b->space);
+        errno = s;
+        return -1;
+    }
+
+    return 0;
+}
+
+int bridgeQueue(struct ipc_bridge *b, int msqid, long mtype)
+{
+    b->kind = BRIDGE_QUEUE;
+    b->id = msqid;
+    b->mtype = mtype;
+
+    return bridgeStart(b, queueHelper);
+}
+
+int bridgeSem(struct ipc_bridge *b, int semid, unsigned short semNum)
+{
+    b->kind = BRIDGE_SEM;
+    b->id = semid;
+    b->semNum = semNum;
+
+    return bridgeStart(b, semHelper);
+}
+
+/* Called with the lock held when nothing is pending */
+static int drained(struct ipc_bridge *b)
+{
+    uint64_t v;
+
+    read(b->efd, &v, sizeof(v)); /* Reset; EAGAIN if already zero */
+    errno = b->error ? b->error : EAGAIN;
+    return -1;
+}
+
+ssize_t bridgeRecv(struct ipc_bridge *b, struct mbuf *msg, size_t maxBytes)
+{
+    ssize_t len;
+
+    pthread_mutex_lock(&b->lock);
+
+    if (b->count == 0) {
+        len = drained(b);
+        pthread_mutex_unlock(&b->lock);
+        return len;
+    }
+
+    len = b->lens[b->head];
+
+    if ((size_t) len > maxBytes) {
+        len = maxBytes; /* Truncated like MSG_NOERROR */
+    }
+
+    msg->mtype = b->ring[b->head].mtype;
+    memcpy(msg->mtext, b->ring[b->head].mtext, len);
+    b->head = (b->head + 1) % BRIDGE_RING;
+
+    if (b->count-- == BRIDGE_RING) {
+        pthread_cond_signal(&b->space);
+    }
+
+    pthread_mutex_unlock(&b->lock);
+    return len;
+}
+
+long bridgeTake(struct ipc_bridge *b) /* Units acquired since the last call */
+{
+    long n;
+
+    pthread_mutex_lock(&b->lock);
+    n = b->units;
+    b->units = 0;
+
+    if (n == 0) {
+        n = drained(b);
+    }
+
+    pthread_mutex_unlock(&b->lock);
+    return n;
+}
+
+int bridgeClose(struct ipc_bridge *b)
+{
+    struct sembuf sop;
+    int done, waited, status = 0;
+
+    pthread_mutex_lock(&b->lock);
+    b->stop = 1;
+    pthread_cond_signal(&b->space);
+    pthread_mutex_unlock(&b->lock);
+
+    /* The signal may land just before the helper blocks, so repeat it
+       until the helper has noticed stop */
+    for (;;) {
+        pthread_mutex_lock(&b->lock);
+        done = b->done;
+        pthread_mutex_unlock(&b->lock);
+
+        if (done) {
+            break;
+        }
+
+        pthread_kill(b->thread, BRIDGE_SIGNAL);
+        usleep(1000);
+    }
+
+    pthread_join(b->thread, NULL);
+
+    /* Hand back what the reactor never collected */
+    if (b->kind == BRIDGE_SEM && b->units > 0) {
+        sop.sem_num = b->semNum;
+        sop.sem_op = b->units;
+        sop.sem_flg = 0;
+
+        if (semop(b->id, &sop, 1) == -1 && errno != EIDRM && errno != EINVAL) {
+            status = -1;
+        }
+    }
+
+    /* A full queue gets BRIDGE_CLOSE_MS to make room; after that the rest
+       stays in the ring for the caller instead of being dropped */
+    for (waited = 0; b->count > 0; ) {
+        if (msgsnd(b->id, &b->ring[b->head], b->lens[b->head], IPC_NOWAIT) == -1) {
+            if (errno == EAGAIN && waited < BRIDGE_CLOSE_MS) {
+                usleep(1000);
+                waited++;
+                continue;
+            }
+
+            if (errno != EIDRM && errno != EINVAL) {
+                status = -1;
+                break;
+            }
+        }
+
+        b->head = (b->head + 1) % BRIDGE_RING;
+        b->count--;
+    }
+
+    close(b->efd);
+    pthread_mutex_destroy(&b->lock);
+    pthread_cond_destroy(&b->space);
+    return status;
+}
@@ -0,0 +1,60 @@
+#ifndef IPC_EVENTFD_H
+#define IPC_EVENTFD_H /* Prevent accidental double inclusion */
+
+#include <signal.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include "../lab1/message_queue.h"
+
+/* A bridge turns one System V queue or semaphore into an eventfd that
+   select() or epoll can watch next to sockets. A small helper thread blocks
+   in msgrcv()/semop() on the reactor's behalf and, once woken, drains what
+   else is ready with IPC_NOWAIT, so a burst costs one eventfd write.
+   bridgeClose() interrupts the helper with BRIDGE_SIGNAL, which gets an
+   empty handler installed process-wide. */
+#define BRIDGE_RING 32 /* Messages buffered per queue bridge */
+#define BRIDGE_SEM_BATCH 64 /* Max semaphore units taken per wakeup */
+#define BRIDGE_STACK (64 * 1024) /* Helpers only run syscalls */
+#define BRIDGE_CLOSE_MS 1000 /* How long bridgeClose() waits on a full queue */
+#ifndef BRIDGE_SIGNAL /* Allow "cc -D" to override definition */
+#define BRIDGE_SIGNAL SIGUSR2
+#endif
+
+enum bridge_kind { BRIDGE_QUEUE, BRIDGE_SEM };
+
+struct ipc_bridge {
+    enum bridge_kind kind;
+    int efd; /* Readable while messages or units are waiting */
+    int id; /* msqid or semid */
+    long mtype; /* Queue: type passed to msgrcv() */
+    unsigned short semNum; /* Semaphore: member decremented */
+    pthread_t thread;
+    pthread_mutex_t lock; /* Guards everything below */
+    pthread_cond_t space; /* Reactor freed ring slots */
+    int stop; /* Set by bridgeClose() */
+    int done; /* Helper has exited */
+    int error; /* errno that ended the helper, 0 while running */
+    unsigned head, count; /* Queue: ring of received messages */
+    long units; /* Semaphore: units taken and not yet handed out */
+    long wakeups, events; /* eventfd writes / messages or units delivered */
+    ssize_t lens[BRIDGE_RING];
+    struct mbuf ring[BRIDGE_RING];
+};
+
+int bridgeQueue(struct ipc_bridge *b, int msqid, long mtype);
+int bridgeSem(struct ipc_bridge *b, int semid, unsigned short semNum);
+
+/* Call when b->efd is readable, until -1 with errno EAGAIN. Any other errno
+   is the one that stopped the helper (EIDRM when the object was removed). */
+ssize_t bridgeRecv(struct ipc_bridge *b, struct mbuf *msg, size_t maxBytes);
+long bridgeTake(struct ipc_bridge *b);
+
+/* Stops the helper and hands back what the reactor never collected:
+   semaphore units with semop(), messages with msgsnd() to the same queue,
+   waiting up to BRIDGE_CLOSE_MS for room. Returns -1 if something could not
+   be handed back; for messages (errno EAGAIN when the queue stayed full)
+   the b->count unsent ones are left in b->ring from b->head. Nothing is
+   handed back to an object that was removed. */
+int bridgeClose(struct ipc_bridge *b);
+
+#endif
@@ -0,0 +1,201 @@
+/*
+ * Compile: gcc -o ipc_reactor ipc_reactor.c ipc_eventfd.c ../lab1/init_queue.c -pthread
+ * Run: ./ipc_reactor semid
+ *      then, from other terminals:
+ *        nc localhost 5557                  (watch events, chat like lab8-1)
+ *        ../lab1/message_send               (queue messages)
+ *        ../lab2/sem_op semid 3             (semaphore units)
+ *      Ctrl+C stops the reactor and hands back anything not yet consumed.
+ *
+ * One select() loop, in the style of lab8-1, serving TCP clients, the lab1
+ * message queue and a lab2 semaphore through ipc_eventfd bridges.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include "ipc_eventfd.h"
+
+#define PORT 5557
+#define MAX_CLIENTS 10
+#define BUF_SIZE 1024
+
+static volatile sig_atomic_t stopping;
+static int clients[MAX_CLIENTS];
+
+static void intHandler(int sig)
+{
+    stopping = 1;
+}
+
+static void broadcast(int from, const char *buf, size_t len, fd_set *all)
+{
+    for (int j = 0; j < MAX_CLIENTS; j++) {
+        if (clients[j] >= 0 && clients[j] != from && write(clients[j], buf, len) == -1 &&
+                (errno == EPIPE || errno == ECONNRESET)) {
+            close(clients[j]); /* Gone: drop it, SIGPIPE is ignored */
+            FD_CLR(clients[j], all);
+            clients[j] = -1;
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    struct ipc_bridge qb, sb;
+    struct sockaddr_in addr;
+    struct sigaction sa;
+    struct mbuf msg;
+    char buf[BUF_SIZE + 64];
+    fd_set all, ready;
+    int sfd, maxfd, j, n, one = 1;
+    long units;
+    ssize_t len;
+
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s semid\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    for (j = 0; j < MAX_CLIENTS; j++) {
+        clients[j] = -1;
+    }
+
+    memset(&sa, 0, sizeof(sa)); /* No SA_RESTART: select() returns EINTR */
+    sigemptyset(&sa.sa_mask);
+    sa.sa_handler = intHandler;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN); /* A vanished client must not kill us mid-batch */
+
+    if (bridgeQueue(&qb, init_queue(), 0) == -1) {
+        perror("bridgeQueue");
+        exit(EXIT_FAILURE);
+    }
+
+    if (bridgeSem(&sb, atoi(argv[1]), 0) == -1) {
+        perror("bridgeSem");
+        exit(EXIT_FAILURE);
+    }
+
+    sfd = socket(AF_INET, SOCK_STREAM, 0);
+
+    if (sfd == -1) {
+        perror("socket");
+        exit(EXIT_FAILURE);
+    }
+
+    setsockopt(sfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(PORT);
+    addr.sin_addr.s_addr = INADDR_ANY;
+
+    if (bind(sfd, (struct sockaddr *) &addr, sizeof(addr)) == -1 || listen(sfd, 5) == -1) {
+        perror("bind/listen");
+        exit(EXIT_FAILURE);
+    }
+
+    FD_ZERO(&all);
+    FD_SET(sfd, &all);
+    FD_SET(qb.efd, &all);
+    FD_SET(sb.efd, &all);
+    maxfd = sfd > qb.efd ? sfd : qb.efd;
+    maxfd = maxfd > sb.efd ? maxfd : sb.efd;
+
+    printf("Reactor on port %d, queue and semaphore %s bridged\n", PORT, argv[1]);
+
+    while (!stopping) {
+        ready = all;
+
+        if (select(maxfd + 1, &ready, NULL, NULL, NULL) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            perror("select");
+            exit(EXIT_FAILURE);
+        }
+
+        if (FD_ISSET(qb.efd, &ready)) {
+            while ((len = bridgeRecv(&qb, &msg, MAX_MTEXT)) != -1) {
+                n = snprintf(buf, sizeof(buf), "queue: type=%ld %.*s\n",
+                             msg.mtype, (int) strnlen(msg.mtext, len), msg.mtext);
+                fputs(buf, stdout);
+                broadcast(-1, buf, n, &all);
+            }
+
+            if (errno != EAGAIN) { /* Queue removed: stop watching it */
+                perror("queue bridge");
+                FD_CLR(qb.efd, &all);
+            }
+        }
+
+        if (FD_ISSET(sb.efd, &ready)) {
+            while ((units = bridgeTake(&sb)) != -1) {
+                n = snprintf(buf, sizeof(buf), "sem: +%ld\n", units);
+                fputs(buf, stdout);
+                broadcast(-1, buf, n, &all);
+            }
+
+            if (errno != EAGAIN) {
+                perror("semaphore bridge");
+                FD_CLR(sb.efd, &all);
+            }
+        }
+
+        if (FD_ISSET(sfd, &ready)) {
+            int cfd = accept(sfd, NULL, NULL);
+
+            for (j = 0; cfd >= 0 && j < MAX_CLIENTS && clients[j] >= 0; j++) {
+                continue;
+            }
+
+            if (cfd >= 0 && j == MAX_CLIENTS) {
+                close(cfd);
+            } else if (cfd >= 0) {
+                clients[j] = cfd;
+                FD_SET(cfd, &all);
+                maxfd = cfd > maxfd ? cfd : maxfd;
+            }
+        }
+
+        for (j = 0; j < MAX_CLIENTS; j++) {
+            int fd = clients[j];
+
+            if (fd < 0 || !FD_ISSET(fd, &ready)) {
+                continue;
+            }
+
+            len = read(fd, buf, BUF_SIZE);
+
+            if (len <= 0) {
+                close(fd);
+                FD_CLR(fd, &all);
+                clients[j] = -1;
+            } else {
+                broadcast(fd, buf, len, &all);
+            }
+        }
+    }
+
+    printf("\nqueue: %ld messages in %ld wakeups\n", qb.events, qb.wakeups);
+    printf("sem:   %ld units in %ld wakeups\n", sb.events, sb.wakeups);
+
+    if (bridgeClose(&qb) == -1) {
+        perror("bridgeClose queue");
+        fprintf(stderr, "%u messages could not be put back on the queue\n", qb.count);
+    }
+
+    if (bridgeClose(&sb) == -1) {
+        perror("bridgeClose sem");
+    }
+
+    exit(EXIT_SUCCESS);
+}